@@ -0,0 +1,64 @@
+//Measures the cost of turning validation results into JS values. Every
+//address is validated once to warm the result cache, after which validateMany
+//only unmarshals the input and marshals the cached result, so the time per
+//result is dominated by marshalling.
+//
+//  npm run build && node bench/marshal.bench.js [batchSize] [rounds]
+const { AddressValidator } = require("../dist/index.js");
+
+const batchSize = Number(process.argv[2] || 1000);
+const rounds = Number(process.argv[3] || 50);
+
+const cache = {};
+const validator = new AddressValidator({
+    request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+    get: async (key) => cache[key],
+    put: (key, val) => cache[key] = val,
+    resultCache: { maxEntries: 16 },
+});
+
+const cases = {
+    "valid": {
+        region_code: 'US',
+        address_line: ['441 n water st', 'Suite 200'],
+        administrative_area: 'OR',
+        locality: 'Silverton',
+        postal_code: "97381",
+        organization: "Portrait Express",
+        recipient: "Payton Doud",
+    },
+    "several problems": {
+        region_code: 'US',
+        address_line: [],
+        administrative_area: 'ZZ',
+        postal_code: "9738",
+        sorting_code: "X",
+        dependent_locality: "Nowhere",
+    },
+};
+
+async function run(name, address) {
+    const batch = new Array(batchSize).fill(address);
+    await validator.validateMany(batch.slice(0, 1));
+
+    //Warm up the JIT before measuring
+    for(let i = 0; i < 5; i++) await validator.validateMany(batch);
+
+    const start = process.hrtime.bigint();
+    for(let i = 0; i < rounds; i++) {
+        await validator.validateMany(batch);
+    }
+    const elapsed = Number(process.hrtime.bigint() - start);
+
+    const perResult = elapsed / (batchSize * rounds);
+    console.log(`${name.padEnd(20)} ${perResult.toFixed(0).padStart(8)} ns/result`);
+}
+
+(async () => {
+    for(const [name, address] of Object.entries(cases)) {
+        await run(name, address);
+    }
+
+    const stats = validator.getStats().results;
+    console.log(`result cache: ${stats.hits} hits, ${stats.misses} misses`);
+})();
@@ -0,0 +1,295 @@
+//Micro benchmarks of the native hot paths, against libaddressinput's bundled
+//test data so results don't depend on the network. Build with
+//-DADDRESSINPUT_BENCHMARKS=ON and run with --benchmark_format=json (or
+//--benchmark_out=<file> --benchmark_out_format=json) for machine readable
+//output.
+//
+//Marshalling to and from JS needs a live environment and is measured by
+//bench/marshal.bench.js instead.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_formatter.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/ondemand_supplier.h>
+
+#include "testdata_source.h"
+
+#include "address_columns.h"
+#include "address_strings.h"
+#include "problem_mask.h"
+#include "record_parser.h"
+#include "result_cache.h"
+#include "suggestion_index.h"
+
+namespace {
+
+using i18n::addressinput::AddressData;
+using i18n::addressinput::AddressValidator;
+using i18n::addressinput::FieldProblemMap;
+
+struct Sample {
+    const char *name;
+    AddressData address;
+};
+
+const std::vector<Sample>& samples() {
+    static const std::vector<Sample> samples = [] {
+        std::vector<Sample> ret(6);
+
+        ret[0].name = "US";
+        ret[0].address.region_code = "US";
+        ret[0].address.address_line = {"441 N Water St"};
+        ret[0].address.administrative_area = "OR";
+        ret[0].address.locality = "Silverton";
+        ret[0].address.postal_code = "97381";
+        ret[0].address.organization = "Portrait Express";
+
+        ret[1].name = "CA";
+        ret[1].address.region_code = "CA";
+        ret[1].address.address_line = {"111 Wellington St"};
+        ret[1].address.administrative_area = "ON";
+        ret[1].address.locality = "Ottawa";
+        ret[1].address.postal_code = "K1A 0A9";
+
+        ret[2].name = "GB";
+        ret[2].address.region_code = "GB";
+        ret[2].address.address_line = {"10 Downing Street"};
+        ret[2].address.locality = "London";
+        ret[2].address.postal_code = "SW1A 2AA";
+
+        ret[3].name = "DE";
+        ret[3].address.region_code = "DE";
+        ret[3].address.address_line = {"Platz der Republik 1"};
+        ret[3].address.locality = "Berlin";
+        ret[3].address.postal_code = "11011";
+
+        ret[4].name = "JP";
+        ret[4].address.region_code = "JP";
+        ret[4].address.address_line = {"1-1 Chiyoda"};
+        ret[4].address.administrative_area = "東京都";
+        ret[4].address.locality = "千代田区";
+        ret[4].address.postal_code = "100-8111";
+
+        ret[5].name = "BR";
+        ret[5].address.region_code = "BR";
+        ret[5].address.address_line = {"Rua Augusta 1000"};
+        ret[5].address.administrative_area = "SP";
+        ret[5].address.locality = "São Paulo";
+        ret[5].address.postal_code = "01304-001";
+
+        return ret;
+    }();
+    return samples;
+}
+
+//The test data source answers synchronously, so validation has completed by
+//the time Validate returns
+class Validated : public AddressValidator::Callback {
+public:
+    void operator()(bool success, const AddressData& address, const FieldProblemMap& problems) const override {
+        benchmark::DoNotOptimize(success);
+    }
+};
+
+class Environment {
+public:
+    Environment()
+        : _supplier(new i18n::addressinput::TestdataSource(false, ADDRESSINPUT_TESTDATA),
+                    new i18n::addressinput::NullStorage)
+        , _validator(&_supplier) { }
+
+    void Validate(const AddressData& address, FieldProblemMap *problems) {
+        _validator.Validate(address, true, false, nullptr, problems, _validated);
+    }
+
+private:
+    i18n::addressinput::OndemandSupplier _supplier;
+    AddressValidator _validator;
+    Validated _validated;
+};
+
+void BM_ValidateWarm(benchmark::State& state) {
+    const Sample& sample = samples()[state.range(0)];
+    state.SetLabel(sample.name);
+
+    Environment env;
+    FieldProblemMap problems;
+    env.Validate(sample.address, &problems);
+
+    for(auto _ : state) {
+        problems.clear();
+        env.Validate(sample.address, &problems);
+        benchmark::DoNotOptimize(problems);
+    }
+}
+BENCHMARK(BM_ValidateWarm)->DenseRange(0, 5);
+
+//Includes loading and parsing every rule the address needs
+void BM_ValidateCold(benchmark::State& state) {
+    const Sample& sample = samples()[state.range(0)];
+    state.SetLabel(sample.name);
+
+    for(auto _ : state) {
+        Environment env;
+        FieldProblemMap problems;
+        env.Validate(sample.address, &problems);
+        benchmark::DoNotOptimize(problems);
+    }
+}
+BENCHMARK(BM_ValidateCold)->DenseRange(0, 5);
+
+void BM_FormatNational(benchmark::State& state) {
+    const Sample& sample = samples()[state.range(0)];
+    state.SetLabel(sample.name);
+
+    std::vector<std::string> lines;
+    for(auto _ : state) {
+        lines.clear();
+        i18n::addressinput::GetFormattedNationalAddress(sample.address, &lines);
+        benchmark::DoNotOptimize(lines);
+    }
+}
+BENCHMARK(BM_FormatNational)->DenseRange(0, 5);
+
+//What strtofield/strtoprob do for every entry of a filter
+void BM_ParseFilter(benchmark::State& state) {
+    const std::vector<std::pair<std::string, std::string>> filter = {
+        {"COUNTRY", "UNEXPECTED_FIELD"},
+        {"POSTAL_CODE", "MISMATCHING_VALUE"},
+        {"POSTAL_CODE", "INVALID_FORMAT"},
+        {"RECIPIENT", "MISSING_REQUIRED_FIELD"},
+        {"STREET_ADDRESS", "USES_P_O_BOX"},
+    };
+
+    for(auto _ : state) {
+        FieldProblemMap parsed;
+        for(auto& item : filter) {
+            i18n::addressinput::AddressField field;
+            i18n::addressinput::AddressProblem problem;
+            i18n::addressinput::ParseAddressField(item.first, &field);
+            i18n::addressinput::ParseAddressProblem(item.second, &problem);
+            parsed.insert({field, problem});
+        }
+        benchmark::DoNotOptimize(parsed);
+    }
+}
+BENCHMARK(BM_ParseFilter);
+
+void BM_ProblemMask(benchmark::State& state) {
+    FieldProblemMap problems = {
+        {i18n::addressinput::POSTAL_CODE, i18n::addressinput::MISMATCHING_VALUE},
+        {i18n::addressinput::ADMIN_AREA, i18n::addressinput::UNKNOWN_VALUE},
+        {i18n::addressinput::RECIPIENT, i18n::addressinput::MISSING_REQUIRED_FIELD},
+    };
+
+    uint32_t words[i18n::addressinput::kProblemMaskWords];
+    for(auto _ : state) {
+        i18n::addressinput::WriteProblemMask(problems, words);
+        benchmark::DoNotOptimize(words);
+    }
+}
+BENCHMARK(BM_ProblemMask);
+
+void BM_ResultCacheKey(benchmark::State& state) {
+    const AddressData& address = samples()[0].address;
+    FieldProblemMap filter;
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(i18n::addressinput::ResultCache::Key(address, true, false, filter));
+    }
+}
+BENCHMARK(BM_ResultCacheKey);
+
+void BM_Suggest(benchmark::State& state) {
+    static const char* const kStates[] = {
+        "Alabama", "Alaska", "Arizona", "Arkansas", "California", "Colorado", "Connecticut",
+        "Delaware", "Florida", "Georgia", "Hawaii", "Idaho", "Illinois", "Indiana", "Iowa",
+        "Kansas", "Kentucky", "Louisiana", "Maine", "Maryland", "Massachusetts", "Michigan",
+        "Minnesota", "Mississippi", "Missouri", "Montana", "Nebraska", "Nevada", "New Hampshire",
+        "New Jersey", "New Mexico", "New York", "North Carolina", "North Dakota", "Ohio",
+        "Oklahoma", "Oregon", "Pennsylvania", "Rhode Island", "South Carolina", "South Dakota",
+        "Tennessee", "Texas", "Utah", "Vermont", "Virginia", "Washington", "West Virginia",
+        "Wisconsin", "Wyoming"
+    };
+
+    i18n::addressinput::SuggestionIndex index;
+    for(const char* name : kStates) {
+        index.Add({std::string(name, 2), name});
+    }
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(index.Suggest("Pensylvannia", 5));
+    }
+}
+BENCHMARK(BM_Suggest);
+
+void BM_ReadColumns(benchmark::State& state) {
+    constexpr size_t kCount = 1000;
+    std::string regions, postal_codes, lines;
+    std::vector<uint32_t> region_offsets{0}, postal_offsets{0}, line_offsets{0};
+    for(size_t i = 0; i < kCount; i++) {
+        regions += "US";
+        postal_codes += "97381";
+        lines += "441 N Water St\nSuite 1";
+        region_offsets.push_back(regions.size());
+        postal_offsets.push_back(postal_codes.size());
+        line_offsets.push_back(lines.size());
+    }
+
+    std::string error;
+    i18n::addressinput::AddressColumns columns(kCount);
+    columns.Set(i18n::addressinput::REGION_CODE_KEY, {regions, region_offsets.data(), region_offsets.size()}, &error);
+    columns.Set(i18n::addressinput::POSTAL_CODE_KEY, {postal_codes, postal_offsets.data(), postal_offsets.size()}, &error);
+    columns.Set(i18n::addressinput::ADDRESS_LINE_KEY, {lines, line_offsets.data(), line_offsets.size()}, &error);
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(columns.ReadAll());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * kCount);
+}
+BENCHMARK(BM_ReadColumns);
+
+std::string repeat_records(const std::string& header, const std::string& record, size_t count) {
+    std::string ret = header;
+    for(size_t i = 0; i < count; i++) ret += record;
+    return ret;
+}
+
+void BM_ParseRecords(benchmark::State& state) {
+    bool csv = state.range(0) == 1;
+    state.SetLabel(csv ? "csv" : "ndjson");
+
+    std::string input = csv
+        ? repeat_records("region_code,address_line_1,administrative_area,locality,postal_code\n",
+                "US,\"441 N Water St\",OR,Silverton,97381\n", 1000)
+        : repeat_records("", "{\"region_code\":\"US\",\"address_line\":[\"441 N Water St\"],"
+                "\"administrative_area\":\"OR\",\"locality\":\"Silverton\",\"postal_code\":\"97381\"}\n", 1000);
+
+    for(auto _ : state) {
+        i18n::addressinput::AddressRecordParser parser(
+                csv ? i18n::addressinput::AddressRecordParser::CSV : i18n::addressinput::AddressRecordParser::NDJSON,
+                1 << 20);
+
+        //Fed in socket sized chunks like a stream would
+        for(size_t offset = 0; offset < input.size(); offset += 16384) {
+            parser.Write(input.data() + offset, std::min<size_t>(16384, input.size() - offset));
+        }
+        parser.End();
+        benchmark::DoNotOptimize(parser.Take(parser.Pending()));
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(input.size()));
+    state.SetItemsProcessed(int64_t(state.iterations()) * 1000);
+}
+BENCHMARK(BM_ParseRecords)->Arg(0)->Arg(1);
+
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "access_profile.h"
+#include "lookup_key.h"
+
+namespace {
+
+constexpr char kDataKeyPrefix[] = "data/";
+constexpr char kLanguageSeparator[] = "--";
+
+}
+
+i18n::addressinput::AccessProfile::AccessProfile(size_t max_keys) : _max_keys(max_keys) { }
+
+void i18n::addressinput::AccessProfile::Record(const std::string& key) {
+    auto it = _counts.find(key);
+    if(it != _counts.end()) {
+        it->second++;
+    } else if(_counts.size() < _max_keys) {
+        _counts.emplace(key, 1);
+    }
+}
+
+std::vector<std::pair<std::string, uint64_t>> i18n::addressinput::AccessProfile::Hottest(size_t limit) const {
+    std::vector<std::pair<std::string, uint64_t>> ret(_counts.begin(), _counts.end());
+
+    auto hotter = [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    if(ret.size() > limit) {
+        std::partial_sort(ret.begin(), ret.begin() + limit, ret.end(), hotter);
+        ret.resize(limit);
+    } else {
+        std::sort(ret.begin(), ret.end(), hotter);
+    }
+    return ret;
+}
+
+size_t i18n::addressinput::AccessProfile::Size() const {
+    return _counts.size();
+}
+
+bool i18n::addressinput::AccessProfile::ToAddress(const std::string& key, AddressData* address) {
+    const size_t prefix_length = sizeof kDataKeyPrefix - 1;
+    if(key.compare(0, prefix_length, kDataKeyPrefix) != 0) return false;
+
+    std::string path = key.substr(prefix_length);
+    size_t language = path.find(kLanguageSeparator);
+    if(language != std::string::npos) {
+        address->language_code = path.substr(language + sizeof kLanguageSeparator - 1);
+        path.resize(language);
+    }
+
+    std::string *fields[] = {
+        &address->region_code,
+        &address->administrative_area,
+        &address->locality,
+        &address->dependent_locality
+    };
+    size_t depth = 0;
+    size_t begin = 0;
+    for(;;) {
+        if(depth == sizeof(fields) / sizeof(*fields)) return false;
+
+        size_t end = path.find('/', begin);
+        *fields[depth++] = path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        if(end == std::string::npos) break;
+        begin = end + 1;
+    }
+    return !address->region_code.empty();
+}
+
+i18n::addressinput::ProfilingSupplier::ProfilingSupplier(Supplier *supplier, AccessProfile *profile)
+    : _supplier(supplier), _profile(profile) { }
+
+void i18n::addressinput::ProfilingSupplier::Supply(const LookupKey& lookup_key, const Callback& supplied) {
+    _profile->Record(lookup_key.ToKeyString(lookup_key.GetDepth()));
+    _supplier->Supply(lookup_key, supplied);
+}
+
+void i18n::addressinput::ProfilingSupplier::SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) {
+    _profile->Record(lookup_key.ToKeyString(lookup_key.GetDepth()));
+    _supplier->SupplyGlobally(lookup_key, supplied);
+}
+
+size_t i18n::addressinput::ProfilingSupplier::GetLoadedRuleDepth(const std::string& region_code) const {
+    return _supplier->GetLoadedRuleDepth(region_code);
+}
@@ -0,0 +1,65 @@
+#ifndef INCLUDE_CPP_ACCESS_PROFILE_H_
+#define INCLUDE_CPP_ACCESS_PROFILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/supplier.h>
+
+namespace i18n {
+namespace addressinput {
+
+//How often each rule key, e.g. "data/US/CA", was looked up. Exported after a
+//process has seen real traffic, it tells the next one which keys to load
+//before the first validations need them.
+class AccessProfile {
+public:
+    //Keys first seen once max_keys are already counted aren't recorded, so a
+    //stream of misspelled admin areas can't grow the profile without bound
+    explicit AccessProfile(size_t max_keys = 10000);
+
+    void Record(const std::string& key);
+
+    //Up to limit keys with their counts, most looked up first and in key
+    //order on ties
+    std::vector<std::pair<std::string, uint64_t>> Hottest(size_t limit) const;
+
+    size_t Size() const;
+
+    //Fills address with the region and sub region fields, and language, that
+    //look up key. False if key isn't a rule key.
+    static bool ToAddress(const std::string& key, AddressData* address);
+
+private:
+    size_t _max_keys;
+    std::unordered_map<std::string, uint64_t> _counts;
+};
+
+//Records the key of every lookup made through it into an AccessProfile, then
+//hands it on to the wrapped supplier
+class ProfilingSupplier : public Supplier {
+public:
+    //Owns neither supplier nor profile
+    ProfilingSupplier(Supplier *supplier, AccessProfile *profile);
+
+    ProfilingSupplier(const ProfilingSupplier&) = delete;
+    ProfilingSupplier& operator=(const ProfilingSupplier&) = delete;
+
+    void Supply(const LookupKey& lookup_key, const Callback& supplied) override;
+    void SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) override;
+    size_t GetLoadedRuleDepth(const std::string& region_code) const override;
+
+private:
+    Supplier *_supplier;
+    AccessProfile *_profile;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_ACCESS_PROFILE_H_
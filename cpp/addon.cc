@@ -1,6 +1,10 @@
+#include "addon_data.h"
+#include "address_parser.h"
 #include "address_validator.h"
 #include <csignal>
 #include <exception>
+#include <memory>
+#include <mutex>
 #include <napi.h>
 
 #include <iostream>
@@ -38,11 +42,26 @@ void segvhandler(int code) {
     handler();
 }
 
-Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
+void install_handlers() {
     std::set_terminate(handler);
     std::signal(SIGSEGV, segvhandler);
     std::signal(SIGBUS, segvhandler);
     std::signal(SIGABRT, segvhandler);
+}
+
+//Runs once for every environment that loads the addon, i.e. the main thread
+//and each worker thread. Handlers are process wide and only installed once.
+Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
+    static std::once_flag handlers;
+    std::call_once(handlers, install_handlers);
+
+    //A constructor that throws frees its own allocation, but the environment
+    //only owns the data once SetInstanceData has succeeded
+    std::unique_ptr<AddonData> data(new AddonData(env));
+    env.SetInstanceData(data.get());
+    data.release();
+
+    JsAddressParser::Init(env, exports);
     return JsAddressValidator::Init(env, exports);
 }
 
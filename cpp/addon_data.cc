@@ -0,0 +1,8 @@
+#include "addon_data.h"
+
+AddonData::AddonData(Napi::Env env)
+    : names(env) { }
+
+AddonData& AddonData::For(Napi::Env env) {
+    return *env.GetInstanceData<AddonData>();
+}
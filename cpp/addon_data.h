@@ -0,0 +1,25 @@
+#ifndef INCLUDE_CPP_ADDON_DATA_H_
+#define INCLUDE_CPP_ADDON_DATA_H_
+
+#include <napi.h>
+
+#include "property_names.h"
+
+//Everything the addon keeps per JS environment, so that it can be loaded by
+//the main thread and any number of worker threads at once. InitAll sets it as
+//the environment's instance data, and node-addon-api deletes it along with
+//the references it holds when that environment is torn down.
+struct AddonData {
+    explicit AddonData(Napi::Env env);
+
+    AddonData(const AddonData&) = delete;
+    AddonData& operator=(const AddonData&) = delete;
+
+    static AddonData& For(Napi::Env env);
+
+    PropertyNames names;
+    Napi::FunctionReference validator_constructor;
+    Napi::FunctionReference parser_constructor;
+};
+
+#endif  // INCLUDE_CPP_ADDON_DATA_H_
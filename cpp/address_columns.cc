@@ -0,0 +1,86 @@
+#include "address_columns.h"
+
+#include <utility>
+
+namespace {
+
+void split_lines(std::string_view value, std::vector<std::string> *lines) {
+    lines->clear();
+    size_t begin = 0;
+    while(begin <= value.size()) {
+        size_t end = value.find('\n', begin);
+        if(end == std::string_view::npos) end = value.size();
+
+        size_t stop = end;
+        if(stop > begin && value[stop - 1] == '\r') stop--;
+        if(stop > begin) {
+            lines->emplace_back(value.substr(begin, stop - begin));
+        }
+        begin = end + 1;
+    }
+}
+
+}
+
+i18n::addressinput::AddressColumns::AddressColumns(size_t count) : _count(count) { }
+
+bool i18n::addressinput::AddressColumns::Set(AddressDataKey key, const AddressColumn& column, std::string *error) {
+    std::string name = AddressDataKeyName(key);
+    if(column.offset_count != _count + 1) {
+        *error = "Expected " + std::to_string(_count + 1) + " offsets for " + name
+            + ", recieved " + std::to_string(column.offset_count);
+        return false;
+    }
+
+    std::vector<uint32_t> offsets(column.offsets, column.offsets + column.offset_count);
+    for(size_t i = 0; i < _count; i++) {
+        if(offsets[i] > offsets[i + 1]) {
+            *error = "Offsets of " + name + " decrease at " + std::to_string(i + 1);
+            return false;
+        }
+    }
+    if(offsets[_count] > column.data.size()) {
+        *error = "Offsets of " + name + " run past the end of its data";
+        return false;
+    }
+
+    _data[key] = column.data;
+    _offsets[key] = std::move(offsets);
+    return true;
+}
+
+size_t i18n::addressinput::AddressColumns::Count() const {
+    return _count;
+}
+
+std::string_view i18n::addressinput::AddressColumns::Value(AddressDataKey key, size_t index) const {
+    const auto& offsets = _offsets[key];
+    if(offsets.empty()) return std::string_view();
+    return _data[key].substr(offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+void i18n::addressinput::AddressColumns::Read(size_t index, AddressData *address) const {
+    auto assign = [&](AddressDataKey key, std::string *field) {
+        auto value = Value(key, index);
+        field->assign(value.data(), value.size());
+    };
+
+    assign(REGION_CODE_KEY, &address->region_code);
+    assign(LANGUAGE_CODE_KEY, &address->language_code);
+    assign(POSTAL_CODE_KEY, &address->postal_code);
+    assign(SORTING_CODE_KEY, &address->sorting_code);
+    assign(ADMINISTRATIVE_AREA_KEY, &address->administrative_area);
+    assign(DEPENDENT_LOCALITY_KEY, &address->dependent_locality);
+    assign(LOCALITY_KEY, &address->locality);
+    assign(ORGANIZATION_KEY, &address->organization);
+    assign(RECIPIENT_KEY, &address->recipient);
+    split_lines(Value(ADDRESS_LINE_KEY, index), &address->address_line);
+}
+
+std::vector<i18n::addressinput::AddressData> i18n::addressinput::AddressColumns::ReadAll() const {
+    std::vector<AddressData> ret(_count);
+    for(size_t i = 0; i < _count; i++) {
+        Read(i, &ret[i]);
+    }
+    return ret;
+}
@@ -0,0 +1,58 @@
+#ifndef INCLUDE_CPP_ADDRESS_COLUMNS_H_
+#define INCLUDE_CPP_ADDRESS_COLUMNS_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libaddressinput/address_data.h>
+
+#include "address_strings.h"
+
+namespace i18n {
+namespace addressinput {
+
+//One field of a batch of addresses stored back to back as UTF-8. The value of
+//address i is data[offsets[i], offsets[i + 1]). Address lines are separated
+//by '\n' within a value.
+struct AddressColumn {
+    std::string_view data;
+    const uint32_t *offsets = nullptr;
+    size_t offset_count = 0;
+};
+
+//Columns of a batch, indexed by AddressDataKey. Fields without a column are
+//left empty.
+class AddressColumns {
+public:
+    explicit AddressColumns(size_t count);
+
+    //Copies the offsets, then checks the copy describes count values within
+    //data. On failure returns false and sets error. The offsets may be
+    //rewritten by the caller afterwards, e.g. from another thread when they
+    //live in a SharedArrayBuffer, without affecting what is read.
+    bool Set(AddressDataKey key, const AddressColumn& column, std::string *error);
+
+    size_t Count() const;
+
+    //Reads one address out of the columns, reusing the strings already in it
+    void Read(size_t index, AddressData *address) const;
+
+    //Reads every address, in order
+    std::vector<AddressData> ReadAll() const;
+
+private:
+    std::string_view Value(AddressDataKey key, size_t index) const;
+
+    size_t _count;
+    std::string_view _data[kAddressDataKeyCount];
+
+    //Count + 1 each, or empty for fields without a column
+    std::vector<uint32_t> _offsets[kAddressDataKeyCount];
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_ADDRESS_COLUMNS_H_
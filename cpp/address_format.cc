@@ -0,0 +1,57 @@
+#include <libaddressinput/address_formatter.h>
+
+#include "address_format.h"
+
+bool i18n::addressinput::ParseFormatStyle(const std::string& name, FormatStyle *style) {
+    if(name == "national") {
+        *style = FormatStyle::NATIONAL;
+    } else if(name == "latin") {
+        *style = FormatStyle::LATIN;
+    } else if(name == "single_line") {
+        *style = FormatStyle::SINGLE_LINE;
+    } else if(name == "street") {
+        *style = FormatStyle::STREET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+i18n::addressinput::AddressFormatter::AddressFormatter(FormatStyle style) : _style(style) { }
+
+const std::vector<std::string>& i18n::addressinput::AddressFormatter::Lines(const AddressData& address) {
+    switch(_style) {
+        case FormatStyle::NATIONAL:
+            GetFormattedNationalAddress(address, &_lines);
+            break;
+        case FormatStyle::LATIN: {
+            //libaddressinput picks the Latin format for any language code
+            //tagged with the Latn script, e.g. "ja-Latn"
+            std::string language = address.language_code.substr(0, address.language_code.find('-'));
+            _latin = address;
+            _latin.language_code = (language.empty() ? "und" : language) + "-Latn";
+            GetFormattedNationalAddress(_latin, &_lines);
+            break;
+        }
+        case FormatStyle::SINGLE_LINE:
+            _lines.resize(1);
+            GetFormattedNationalAddressLine(address, &_lines[0]);
+            break;
+        case FormatStyle::STREET:
+            _lines.resize(1);
+            GetStreetAddressLinesAsSingleLine(address, &_lines[0]);
+            break;
+    }
+    return _lines;
+}
+
+const std::string& i18n::addressinput::AddressFormatter::Joined(const AddressData& address, char separator) {
+    Lines(address);
+
+    _joined.clear();
+    for(size_t i = 0; i < _lines.size(); i++) {
+        if(i > 0) _joined.push_back(separator);
+        _joined.append(_lines[i]);
+    }
+    return _joined;
+}
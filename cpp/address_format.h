@@ -0,0 +1,56 @@
+#ifndef INCLUDE_CPP_ADDRESS_FORMAT_H_
+#define INCLUDE_CPP_ADDRESS_FORMAT_H_
+
+#include <string>
+#include <vector>
+
+#include <libaddressinput/address_data.h>
+
+namespace i18n {
+namespace addressinput {
+
+enum class FormatStyle {
+    //The region's local format, without the country
+    NATIONAL,
+
+    //The region's Latin script format where it has one, e.g. for JP
+    LATIN,
+
+    //The national format joined onto a single line
+    SINGLE_LINE,
+
+    //Only the street address lines, joined onto a single line
+    STREET
+};
+
+//Accepts "national", "latin", "single_line" and "street". Returns false for
+//anything else.
+bool ParseFormatStyle(const std::string& name, FormatStyle *style);
+
+//Formats addresses one after another into the same buffers, so formatting a
+//batch doesn't allocate per address once the buffers have grown.
+class AddressFormatter {
+public:
+    explicit AddressFormatter(FormatStyle style);
+
+    AddressFormatter(const AddressFormatter&) = delete;
+    AddressFormatter& operator=(const AddressFormatter&) = delete;
+
+    //Both results stay valid until the next call. Single line styles produce
+    //exactly one line.
+    const std::vector<std::string>& Lines(const AddressData& address);
+    const std::string& Joined(const AddressData& address, char separator = '\n');
+
+private:
+    FormatStyle _style;
+    std::vector<std::string> _lines;
+    std::string _joined;
+
+    //Copy of the address with a Latin script language code
+    AddressData _latin;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_ADDRESS_FORMAT_H_
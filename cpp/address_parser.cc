@@ -0,0 +1,74 @@
+#include "address_parser.h"
+
+#include "addon_data.h"
+#include "address_validator.h"
+
+Napi::Object JsAddressParser::Init(Napi::Env env, Napi::Object exports) {
+    Napi::HandleScope scope(env);
+
+    auto func = DefineClass(env, "AddressParser", {
+        InstanceMethod("write", &JsAddressParser::write),
+        InstanceMethod("end", &JsAddressParser::end),
+        InstanceMethod("pending", &JsAddressParser::pending)
+    });
+
+    AddonData::For(env).parser_constructor = Napi::Persistent(func);
+
+    exports.Set("AddressParser", func);
+    return exports;
+}
+
+JsAddressParser::JsAddressParser(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<JsAddressParser>(info) {
+    if(info.Length() < 2) {
+        throw unexpected_type_exception(info.Env(), "Expected a format and a record size limit in arguments");
+    }
+
+    assert_typeof(info.Env(), "format", info[0], napi_valuetype::napi_string);
+    assert_typeof(info.Env(), "maxRecordBytes", info[1], napi_valuetype::napi_number);
+
+    std::string format = info[0].ToString().Utf8Value();
+    double max_record_bytes = info[1].ToNumber().DoubleValue();
+
+    i18n::addressinput::AddressRecordParser::Format parsed_format;
+    if(format == "ndjson") {
+        parsed_format = i18n::addressinput::AddressRecordParser::NDJSON;
+    } else if(format == "csv") {
+        parsed_format = i18n::addressinput::AddressRecordParser::CSV;
+    } else {
+        throw unexpected_type_exception(info.Env(), "Expected format to be one of ndjson|csv, recieved " + format);
+    }
+
+    if(!(max_record_bytes >= 1)) {
+        throw Napi::Error::New(info.Env(), "'maxRecordBytes' must be at least 1.");
+    }
+
+    _parser.reset(new i18n::addressinput::AddressRecordParser(parsed_format, size_t(max_record_bytes)));
+}
+
+i18n::addressinput::AddressRecordParser& JsAddressParser::FromValue(Napi::Env env, Napi::Value value) {
+    if(!value.IsObject() || !value.As<Napi::Object>().InstanceOf(AddonData::For(env).parser_constructor.Value())) {
+        throw unexpected_type_exception(env, "parser", "AddressParser", value.Type());
+    }
+    return *Unwrap(value.As<Napi::Object>())->_parser;
+}
+
+Napi::Value JsAddressParser::write(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1 || !info[0].IsTypedArray()
+            || info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+        throw unexpected_type_exception(info.Env(), "Expected a Buffer or Uint8Array in arguments");
+    }
+
+    auto bytes = info[0].As<Napi::Uint8Array>();
+    _parser->Write(reinterpret_cast<const char*>(bytes.Data()), bytes.ByteLength());
+    return Napi::Number::New(info.Env(), _parser->Pending());
+}
+
+Napi::Value JsAddressParser::end(const Napi::CallbackInfo& info) {
+    _parser->End();
+    return Napi::Number::New(info.Env(), _parser->Pending());
+}
+
+Napi::Value JsAddressParser::pending(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), _parser->Pending());
+}
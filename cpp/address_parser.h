@@ -0,0 +1,28 @@
+#ifndef INCLUDE_CPP_ADDRESS_PARSER_H_
+#define INCLUDE_CPP_ADDRESS_PARSER_H_
+
+#include <memory>
+
+#include <napi.h>
+
+#include "record_parser.h"
+
+//JS handle of an AddressRecordParser. Parsed records stay native until a
+//validator takes them with validateParsed.
+class JsAddressParser : public Napi::ObjectWrap<JsAddressParser> {
+public:
+    JsAddressParser(const Napi::CallbackInfo& info);
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+    //Throws unless value is an AddressParser
+    static i18n::addressinput::AddressRecordParser& FromValue(Napi::Env env, Napi::Value value);
+
+    Napi::Value write(const Napi::CallbackInfo& info);
+    Napi::Value end(const Napi::CallbackInfo& info);
+    Napi::Value pending(const Napi::CallbackInfo& info);
+
+private:
+    std::unique_ptr<i18n::addressinput::AddressRecordParser> _parser;
+};
+
+#endif  // INCLUDE_CPP_ADDRESS_PARSER_H_
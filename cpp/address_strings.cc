@@ -0,0 +1,79 @@
+#include "address_strings.h"
+
+namespace {
+
+const char* const kFieldNames[] = {
+    "COUNTRY",
+    "ADMIN_AREA",
+    "LOCALITY",
+    "DEPENDENT_LOCALITY",
+    "SORTING_CODE",
+    "POSTAL_CODE",
+    "STREET_ADDRESS",
+    "ORGANIZATION",
+    "RECIPIENT",
+};
+
+const char* const kProblemNames[] = {
+    "UNEXPECTED_FIELD",
+    "MISSING_REQUIRED_FIELD",
+    "UNKNOWN_VALUE",
+    "INVALID_FORMAT",
+    "MISMATCHING_VALUE",
+    "USES_P_O_BOX",
+    "UNSUPPORTED_FIELD",
+};
+
+const char* const kDataKeyNames[] = {
+    "region_code",
+    "language_code",
+    "postal_code",
+    "sorting_code",
+    "administrative_area",
+    "dependent_locality",
+    "locality",
+    "organization",
+    "recipient",
+    "address_line",
+};
+
+static_assert(sizeof(kFieldNames) / sizeof(*kFieldNames) == i18n::addressinput::kAddressFieldCount,
+        "AddressField names out of date");
+static_assert(sizeof(kProblemNames) / sizeof(*kProblemNames) == i18n::addressinput::kAddressProblemCount,
+        "AddressProblem names out of date");
+static_assert(sizeof(kDataKeyNames) / sizeof(*kDataKeyNames) == i18n::addressinput::kAddressDataKeyCount,
+        "AddressData key names out of date");
+
+}
+
+const char* i18n::addressinput::AddressFieldName(AddressField field) {
+    return static_cast<size_t>(field) < kAddressFieldCount ? kFieldNames[field] : "";
+}
+
+const char* i18n::addressinput::AddressProblemName(AddressProblem problem) {
+    return static_cast<size_t>(problem) < kAddressProblemCount ? kProblemNames[problem] : "";
+}
+
+bool i18n::addressinput::ParseAddressField(const std::string& name, AddressField *field) {
+    for(size_t i = 0; i < kAddressFieldCount; i++) {
+        if(name == kFieldNames[i]) {
+            *field = static_cast<AddressField>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool i18n::addressinput::ParseAddressProblem(const std::string& name, AddressProblem *problem) {
+    for(size_t i = 0; i < kAddressProblemCount; i++) {
+        if(name == kProblemNames[i]) {
+            *problem = static_cast<AddressProblem>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* i18n::addressinput::AddressDataKeyName(AddressDataKey key) {
+    return static_cast<size_t>(key) < kAddressDataKeyCount ? kDataKeyNames[key] : "";
+}
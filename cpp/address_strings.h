@@ -0,0 +1,47 @@
+#ifndef INCLUDE_CPP_ADDRESS_STRINGS_H_
+#define INCLUDE_CPP_ADDRESS_STRINGS_H_
+
+#include <cstddef>
+#include <string>
+
+#include <libaddressinput/address_field.h>
+#include <libaddressinput/address_problem.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Number of values in the AddressField and AddressProblem enums
+constexpr size_t kAddressFieldCount = RECIPIENT + 1;
+constexpr size_t kAddressProblemCount = UNSUPPORTED_FIELD + 1;
+
+//Names used for the enums on the JS side, e.g. "POSTAL_CODE" and
+//"MISMATCHING_VALUE". Match libaddressinput's own operator<< output.
+const char* AddressFieldName(AddressField field);
+const char* AddressProblemName(AddressProblem problem);
+
+//Inverse of the above. Return false for unknown names.
+bool ParseAddressField(const std::string& name, AddressField *field);
+bool ParseAddressProblem(const std::string& name, AddressProblem *problem);
+
+//Property names of the JS AddressData object, in the order results are built
+enum AddressDataKey {
+    REGION_CODE_KEY,
+    LANGUAGE_CODE_KEY,
+    POSTAL_CODE_KEY,
+    SORTING_CODE_KEY,
+    ADMINISTRATIVE_AREA_KEY,
+    DEPENDENT_LOCALITY_KEY,
+    LOCALITY_KEY,
+    ORGANIZATION_KEY,
+    RECIPIENT_KEY,
+    ADDRESS_LINE_KEY
+};
+
+constexpr size_t kAddressDataKeyCount = ADDRESS_LINE_KEY + 1;
+
+const char* AddressDataKeyName(AddressDataKey key);
+
+}
+}
+
+#endif  // INCLUDE_CPP_ADDRESS_STRINGS_H_
@@ -1,13 +1,39 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iterator>
 #include <cstdio>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <vector>
 
 #include <libaddressinput/address_data.h>
 #include <libaddressinput/address_formatter.h>
-
+#include <libaddressinput/null_storage.h>
+#include <libaddressinput/region_data.h>
+
+#include "addon_data.h"
+#include "address_columns.h"
+#include "address_format.h"
+#include "address_parser.h"
+#include "address_strings.h"
 #include "address_validator.h"
+#include "caching_supplier.h"
+#include "file_storage.h"
+#include "local_dataset_source.h"
+#include "metrics.h"
+#include "preloading_supplier.h"
+#include "problem_mask.h"
+#include "property_names.h"
+#include "resilient_source.h"
+#include "result_cache.h"
+#include "rule.h"
+#include "single_flight.h"
+#include "timers.h"
 #include "libaddressinput/supplier.h"
+#include "lookup_key.h"
+#include "worker_pool.h"
 
 std::string get_napi_type_name(Napi::Env env, napi_valuetype type) {
     switch(type) {
@@ -97,6 +123,13 @@ get_value_from_napi<bool>(Napi::Env env, Napi::Value value, std::string name) {
     return value.ToBoolean().Value();
 }
 
+template<>
+double
+get_value_from_napi<double>(Napi::Env env, Napi::Value value, std::string name) {
+    assert_typeof(env, name, value, napi_valuetype::napi_number);
+    return value.ToNumber().DoubleValue();
+}
+
 template<>
 std::string 
 get_value_from_napi<std::string>(Napi::Env env, Napi::Value value, std::string name) {
@@ -129,6 +162,40 @@ get_value_from_napi<std::vector<std::string>>(
 #define ASSIGN_READ(env, dest, val, type, prop)\
     (dest).prop = get_value_from_napi<type>(env, val.Get(STR(prop)), STR(prop));
 
+template<>
+i18n::addressinput::ResiliencePolicy
+get_value_from_napi<i18n::addressinput::ResiliencePolicy>(
+        Napi::Env env,
+        Napi::Value value,
+        std::string name) {
+    assert_typeof(env, name, value, napi_valuetype::napi_object);
+    auto obj = value.ToObject();
+    i18n::addressinput::ResiliencePolicy ret;
+
+    auto read_duration = [&](const char *prop, double *dest) {
+        auto val = obj.Get(prop);
+        if(val.IsUndefined()) return;
+        *dest = get_value_from_napi<double>(env, val, name + "." + prop);
+        if(!(*dest >= 0)) {
+            throw Napi::Error::New(env, "'" + name + "." + prop + "' must not be negative.");
+        }
+    };
+
+    double retries = ret.retries;
+    read_duration("negativeTtlMs", &ret.negative_ttl_ms);
+    read_duration("retries", &retries);
+    read_duration("backoffMs", &ret.backoff_ms);
+    read_duration("maxBackoffMs", &ret.max_backoff_ms);
+    ret.retries = static_cast<uint32_t>(std::min(retries, 1000.0));
+
+    auto swr = obj.Get("staleWhileRevalidate");
+    if(!swr.IsUndefined()) {
+        ret.stale_while_revalidate = get_value_from_napi<bool>(env, swr, name + ".staleWhileRevalidate");
+    }
+
+    return ret;
+}
+
 
 template<>
 i18n::addressinput::AddressData 
@@ -183,53 +250,47 @@ get_value_from_napi<std::shared_ptr<i18n::addressinput::AddressData>>(
     return ptr;
 }
 
+template<>
+std::vector<i18n::addressinput::AddressData>
+get_value_from_napi<std::vector<i18n::addressinput::AddressData>>(
+        Napi::Env env,
+        Napi::Value value,
+        std::string name) {
+    if(!value.IsArray()) {
+        throw unexpected_type_exception(env, name, value.Type(), "array");
+    }
+
+    Napi::Array arr = value.As<Napi::Array>();
+    std::vector<i18n::addressinput::AddressData> ret;
+    ret.reserve(arr.Length());
+
+    for(uint32_t i = 0; i < arr.Length(); i++) {
+        ret.push_back(get_value_from_napi<i18n::addressinput::AddressData>(
+                    env, arr.Get(i), name+"["+std::to_string(i)+"]"));
+    }
+
+    return ret;
+}
+
 
 i18n::addressinput::AddressProblem strtoprob(Napi::Env env, const std::string& str) {
-    if(str == "UNEXPECTED_FIELD") {
-        return i18n::addressinput::AddressProblem::UNEXPECTED_FIELD;
-    } else if(str == "USES_P_O_BOX") {
-        return i18n::addressinput::AddressProblem::USES_P_O_BOX;
-    } else if(str == "UNSUPPORTED_FIELD") {
-        return i18n::addressinput::AddressProblem::UNSUPPORTED_FIELD;
-    } else if(str == "MISSING_REQUIRED_FIELD") {
-        return i18n::addressinput::AddressProblem::MISSING_REQUIRED_FIELD;
-    } else if(str == "UNKNOWN_VALUE") {
-        return i18n::addressinput::AddressProblem::UNKNOWN_VALUE;
-    } else if(str == "MISMATCHING_VALUE") {
-        return i18n::addressinput::AddressProblem::MISMATCHING_VALUE;
-    } else if(str == "INVALID_FORMAT") {
-        return i18n::addressinput::AddressProblem::INVALID_FORMAT;
-    } else {
+    i18n::addressinput::AddressProblem problem;
+    if(!i18n::addressinput::ParseAddressProblem(str, &problem)) {
         throw unexpected_type_exception(env, "Expected one of UNEXPECTED_FIELD|USES_P_O_BOX|" 
                 "UNSUPPORTED_FIELD|MISSING_REQUIRED_FIELD|UNKNOWN_VALUE|MISMATCHING_VALUE|"
                 "INVALID_FORMAT, recieved " + str);
     }
+    return problem;
 }
 
 i18n::addressinput::AddressField strtofield(Napi::Env env, const std::string& str) {
-    if(str == "STREET_ADDRESS") {
-        return i18n::addressinput::AddressField::STREET_ADDRESS;
-    } else if(str == "ADMIN_AREA") {
-        return i18n::addressinput::AddressField::ADMIN_AREA;
-    } else if(str == "COUNTRY") {
-        return i18n::addressinput::AddressField::COUNTRY;
-    } else if(str == "DEPENDENT_LOCALITY") {
-        return i18n::addressinput::AddressField::DEPENDENT_LOCALITY;
-    } else if(str == "LOCALITY") {
-        return i18n::addressinput::AddressField::LOCALITY;
-    } else if(str == "ORGANIZATION") {
-        return i18n::addressinput::AddressField::ORGANIZATION;
-    } else if(str == "POSTAL_CODE") {
-        return i18n::addressinput::AddressField::POSTAL_CODE;
-    } else if(str == "SORTING_CODE") {
-        return i18n::addressinput::AddressField::SORTING_CODE;
-    } else if(str == "RECIPIENT") {
-        return i18n::addressinput::AddressField::RECIPIENT;
-    } else {
-        throw unexpected_type_exception(env, "Expected one of UNEXPECTED_FIELD|USES_P_O_BOX|" 
-                "UNSUPPORTED_FIELD|MISSING_REQUIRED_FIELD|UNKNOWN_VALUE|MISMATCHING_VALUE|"
-                "INVALID_FORMAT, recieved " + str);
+    i18n::addressinput::AddressField field;
+    if(!i18n::addressinput::ParseAddressField(str, &field)) {
+        throw unexpected_type_exception(env, "Expected one of COUNTRY|ADMIN_AREA|LOCALITY|"
+                "DEPENDENT_LOCALITY|SORTING_CODE|POSTAL_CODE|STREET_ADDRESS|ORGANIZATION|"
+                "RECIPIENT, recieved " + str);
     }
+    return field;
 }
 
 template<>
@@ -263,86 +324,54 @@ Napi::Value to_napi_value(Napi::Env env, const std::string& str) {
 }
 
 Napi::Value to_napi_value(Napi::Env env, const i18n::addressinput::AddressProblem& problem) {
-    std::string str;
-    switch(problem) {
-        case i18n::addressinput::AddressProblem::INVALID_FORMAT:
-            str = "INVALID_FORMAT";
-            break;
-
-        case i18n::addressinput::AddressProblem::MISMATCHING_VALUE:
-            str = "MISMATCHING_VALUE";
-            break;
-
-        case i18n::addressinput::AddressProblem::UNKNOWN_VALUE:
-            str = "UNKNOWN_VALUE";
-            break;
-
-        case i18n::addressinput::AddressProblem::MISSING_REQUIRED_FIELD:
-            str = "MISSING_REQUIRED_FIELD";
-            break;
-
-        case i18n::addressinput::AddressProblem::UNEXPECTED_FIELD:
-            str = "UNEXPECTED_FIELD";
-            break;
-
-        case i18n::addressinput::AddressProblem::UNSUPPORTED_FIELD:
-            str = "UNSUPPORTED_FIELD";
-            break;
-
-        case i18n::addressinput::AddressProblem::USES_P_O_BOX:
-            str = "USES_P_O_BOX";
-            break;
-    }
-    return to_napi_value(env, str);
+    return PropertyNames::For(env).Problem(problem);
 }
 
 Napi::Value to_napi_value(Napi::Env env, const i18n::addressinput::FieldProblemMap& problems) {
+    const PropertyNames& names = PropertyNames::For(env);
     Napi::Object retval = Napi::Object::New(env);
 
-    for(auto set : problems) {
-        std::stringstream ss;
-        ss << set.first; //Serialize AddressField
-        std::string strKey = ss.str();
+    //The multimap is ordered by field, so each field's problems are adjacent
+    for(auto it = problems.begin(); it != problems.end(); ) {
+        auto range = problems.equal_range(it->first);
+        Napi::Array arr = Napi::Array::New(env, std::distance(range.first, range.second));
 
-        if(!retval.Has(strKey)) {
-            retval.Set(strKey, Napi::Array::New(env));
+        uint32_t i = 0;
+        for(auto item = range.first; item != range.second; item++) {
+            arr.Set(i++, names.Problem(item->second));
         }
 
-        Napi::Array arr = retval.Get(strKey).As<Napi::Array>();
-        Napi::Value func = arr.Get("push");
-        assert_typeof(env, "push", func, napi_valuetype::napi_function);
-        func.As<Napi::Function>().Call(arr, {to_napi_value(env, set.second)});
+        retval.Set(names.Field(it->first), arr);
+        it = range.second;
     }
 
     return retval;
 }
 
 Napi::Value to_napi_value(Napi::Env env, const std::vector<std::string>& strs) {
-    Napi::Array arr = Napi::Array::New(env);
-    Napi::Value func = arr.Get("push");
-    assert_typeof(env, "push", func, napi_valuetype::napi_function);
-    auto push = func.As<Napi::Function>();
+    Napi::Array arr = Napi::Array::New(env, strs.size());
 
-    for(auto str : strs) {
-        push.Call(arr, {to_napi_value(env, str)});
+    for(uint32_t i = 0; i < strs.size(); i++) {
+        arr.Set(i, to_napi_value(env, strs[i]));
     }
 
     return arr;
 }
 
 Napi::Value to_napi_value(Napi::Env env, const i18n::addressinput::AddressData& problems) {
+    const PropertyNames& names = PropertyNames::For(env);
     Napi::Object ret = Napi::Object::New(env);
 
-    ret.Set("region_code", to_napi_value(env, problems.region_code));
-    ret.Set("language_code", to_napi_value(env, problems.language_code));
-    ret.Set("postal_code", to_napi_value(env, problems.postal_code));
-    ret.Set("sorting_code", to_napi_value(env, problems.sorting_code));
-    ret.Set("administrative_area", to_napi_value(env, problems.administrative_area));
-    ret.Set("dependent_locality", to_napi_value(env, problems.dependent_locality));
-    ret.Set("locality", to_napi_value(env, problems.locality));
-    ret.Set("organization", to_napi_value(env, problems.organization));
-    ret.Set("recipient", to_napi_value(env, problems.recipient));
-    ret.Set("address_line", to_napi_value(env, problems.address_line));
+    ret.Set(names.DataKey(i18n::addressinput::REGION_CODE_KEY), to_napi_value(env, problems.region_code));
+    ret.Set(names.DataKey(i18n::addressinput::LANGUAGE_CODE_KEY), to_napi_value(env, problems.language_code));
+    ret.Set(names.DataKey(i18n::addressinput::POSTAL_CODE_KEY), to_napi_value(env, problems.postal_code));
+    ret.Set(names.DataKey(i18n::addressinput::SORTING_CODE_KEY), to_napi_value(env, problems.sorting_code));
+    ret.Set(names.DataKey(i18n::addressinput::ADMINISTRATIVE_AREA_KEY), to_napi_value(env, problems.administrative_area));
+    ret.Set(names.DataKey(i18n::addressinput::DEPENDENT_LOCALITY_KEY), to_napi_value(env, problems.dependent_locality));
+    ret.Set(names.DataKey(i18n::addressinput::LOCALITY_KEY), to_napi_value(env, problems.locality));
+    ret.Set(names.DataKey(i18n::addressinput::ORGANIZATION_KEY), to_napi_value(env, problems.organization));
+    ret.Set(names.DataKey(i18n::addressinput::RECIPIENT_KEY), to_napi_value(env, problems.recipient));
+    ret.Set(names.DataKey(i18n::addressinput::ADDRESS_LINE_KEY), to_napi_value(env, problems.address_line));
 
     return ret;
 }
@@ -352,17 +381,47 @@ Napi::Value to_napi_value(
         const std::pair<
             const i18n::addressinput::AddressData&, 
             const i18n::addressinput::FieldProblemMap&>& pair) {
-    Napi::Array arr = Napi::Array::New(env);
-    Napi::Value func = arr.Get("push");
-    assert_typeof(env, "push", func, napi_valuetype::napi_function);
-    auto push = func.As<Napi::Function>();
+    Napi::Array arr = Napi::Array::New(env, 2);
 
-    push.Call(arr, { to_napi_value(env, pair.first) });
-    push.Call(arr, { to_napi_value(env, pair.second) });
+    arr.Set(0u, to_napi_value(env, pair.first));
+    arr.Set(1u, to_napi_value(env, pair.second));
 
     return arr;
 }
 
+Napi::Value to_napi_value(
+        Napi::Env env,
+        const std::vector<i18n::addressinput::AddressData>& addresses,
+        const std::vector<i18n::addressinput::FieldProblemMap>& problems,
+        ResultFormat format) {
+    if(format == ResultFormat::PROBLEM_MASK) {
+        //Zero filled, so addresses without problems need no writes
+        auto masks = Napi::Uint32Array::New(env, problems.size() * i18n::addressinput::kProblemMaskWords);
+        uint32_t *words = masks.Data();
+        for(size_t i = 0; i < problems.size(); i++) {
+            if(problems[i].empty()) continue;
+            i18n::addressinput::WriteProblemMask(problems[i], words + i * i18n::addressinput::kProblemMaskWords);
+        }
+        return masks;
+    }
+
+    Napi::Array results = Napi::Array::New(env, addresses.size());
+    for(uint32_t i = 0; i < addresses.size(); i++) {
+        results.Set(i, to_napi_value(env, std::make_pair(
+                        std::cref(addresses[i]), std::cref(problems[i]))));
+    }
+    return results;
+}
+
+//Times turning results into JS values
+template<typename Marshal>
+Napi::Value timed_marshal(i18n::addressinput::ValidatorMetrics& metrics, Marshal marshal) {
+    auto start = i18n::addressinput::ValidatorMetrics::Clock::now();
+    Napi::Value ret = marshal();
+    metrics.marshal.Since(start);
+    return ret;
+}
+
 
 void then(Napi::Promise promise, std::function<void (const Napi::CallbackInfo&)> callback) {
     auto then = promise.Get("then");
@@ -373,7 +432,26 @@ void then(Napi::Promise promise, std::function<void (const Napi::CallbackInfo&)>
     then.As<Napi::Function>().Call(promise, {Napi::Function::New(promise.Env(), callback)});
 }
 
-void handle_get_result(Napi::Env env, const std::string& key, Napi::Value result, const i18n::addressinput::Source::Callback& data_ready) {
+void then(
+        Napi::Promise promise,
+        std::function<void (const Napi::CallbackInfo&)> callback,
+        std::function<void (const Napi::CallbackInfo&)> rejected) {
+    auto then = promise.Get("then");
+    if(!then.IsFunction()) {
+        throw unexpected_type_exception(promise.Env(), "promise is not thenable");
+    }
+
+    then.As<Napi::Function>().Call(promise, {
+            Napi::Function::New(promise.Env(), callback),
+            Napi::Function::New(promise.Env(), rejected)});
+}
+
+void handle_get_result(
+        Napi::Env env,
+        const std::string& key,
+        Napi::Value result,
+        const i18n::addressinput::Source::Callback& data_ready,
+        i18n::addressinput::PendingGets& pending) {
     auto cb = [&data_ready, key](Napi::Value v) {
         if(v.IsString()) {
             std::string *data = new std::string(v.ToString().Utf8Value());
@@ -388,13 +466,19 @@ void handle_get_result(Napi::Env env, const std::string& key, Napi::Value result
     };
 
     if(result.IsPromise()) {
+        //The get may be abandoned before the promise settles, so data_ready
+        //is only ever reached through it
+        auto get = pending.Add(env, key, data_ready);
         auto promise = result.As<Napi::Promise>();
-        then(promise, [&data_ready, key, cb](const Napi::CallbackInfo& info) {
-            if(info.Length() <= 0 || info[0].IsNull() || info[0].IsUndefined()) {
-                data_ready(false, key, nullptr);
+        then(promise, [get](const Napi::CallbackInfo& info) {
+            if(info.Length() > 0 && info[0].IsString()) {
+                get->Settle(true, new std::string(info[0].ToString().Utf8Value()));
             } else {
-                cb(info[0]);
+                get->Settle(false, nullptr);
             }
+        }, [get](const Napi::CallbackInfo& info) {
+            //A rejected request is a failed lookup, not a hung one
+            get->Settle(false, nullptr);
         });
     } else {
         cb(result);
@@ -406,7 +490,7 @@ void i18n::addressinput::JsDelegatedSource::Get(const std::string& key, const Ca
 
     try {
         auto result = _get->Call({Napi::String::New(_get->Env(), key)});
-        handle_get_result(_get->Env(), key, result, data_ready);
+        handle_get_result(_get->Env(), key, result, data_ready, _pending);
     } catch(Napi::Error& err) {
         //TODO - figure out a way to propagate this error message....
         data_ready(false, key, nullptr);
@@ -417,12 +501,28 @@ void i18n::addressinput::JsDelegatedSource::SetAcquisition(Napi::Function func)
     _get = Napi::Persistent(func);
 }
 
+i18n::addressinput::PendingGets& i18n::addressinput::JsDelegatedSource::Pending() const {
+    return _pending;
+}
+
 void i18n::addressinput::JsDelegatedStorage::Get(const std::string& key, const Callback& data_ready) const {
-    if(!_get) throw missing_callback("No storage retrieve callback registered");
+    //A put still waiting to be written is the freshest copy
+    if(_buffer) {
+        const std::string *buffered = _buffer->Find(key);
+        if(buffered != nullptr) {
+            data_ready(true, key, new std::string(*buffered));
+            return;
+        }
+    }
+
+    if(!_get) {
+        data_ready(false, key, nullptr);
+        return;
+    }
 
     try {
         auto result = _get->Call({Napi::String::New(_get->Env(), key)});
-        handle_get_result(_get->Env(), key, result, data_ready);
+        handle_get_result(_get->Env(), key, result, data_ready, _pending);
     } catch(Napi::Error& err) {
         //TODO - figure out a way to propagate this error message....
         data_ready(false, key, nullptr);
@@ -434,7 +534,24 @@ void i18n::addressinput::JsDelegatedStorage::SetAcquisition(Napi::Function func)
 }
 
 void i18n::addressinput::JsDelegatedStorage::Put(const std::string &key, std::string *data) {
-    if(!_put) throw missing_callback("No storage save callback registered");
+    if(_buffer) {
+        std::unique_ptr<std::string> owned(data);
+        if(_buffer->Put(key, std::move(*owned)) && _max_delay_ms > 0) {
+            //Keeps the process alive until the batch is written. Does nothing
+            //if the batch was written early or the validator is gone.
+            std::weak_ptr<WriteBehindBuffer> buffer = _buffer;
+            uint64_t batch = _buffer->Batch();
+            set_timeout(_put_many->Env(), [buffer, batch]() {
+                if(auto alive = buffer.lock()) alive->Flush(batch);
+            }, _max_delay_ms);
+        }
+        return;
+    }
+
+    if(!_put) {
+        delete data;
+        return;
+    }
 
     auto result = _put->Call({
             Napi::String::New(_put->Env(), key), 
@@ -445,6 +562,85 @@ void i18n::addressinput::JsDelegatedStorage::SetStore(Napi::Function func) {
     _put = Napi::Persistent(func);
 }
 
+void i18n::addressinput::JsDelegatedStorage::SetBatchedStore(Napi::Function func, size_t max_entries, double max_delay_ms) {
+    _put_many = Napi::Persistent(func);
+    _max_delay_ms = max_delay_ms;
+
+    //The buffer never outlives this storage, timers only hold it weakly
+    _buffer = std::make_shared<WriteBehindBuffer>(max_entries, [this](WriteBehindBuffer::Entries&& entries) {
+        WriteBatch(std::move(entries));
+    });
+}
+
+void i18n::addressinput::JsDelegatedStorage::WriteBatch(WriteBehindBuffer::Entries&& entries) {
+    Napi::Env env = _put_many->Env();
+    Napi::Array batch = Napi::Array::New(env, entries.size());
+    for(uint32_t i = 0; i < entries.size(); i++) {
+        Napi::Array entry = Napi::Array::New(env, 2);
+        entry.Set(0u, Napi::String::New(env, entries[i].first));
+        entry.Set(1u, Napi::String::New(env, entries[i].second));
+        batch.Set(i, entry);
+    }
+
+    try {
+        auto result = _put_many->Call({batch});
+        if(_flushed != nullptr) {
+            *_flushed = result;
+        } else if(result.IsPromise()) {
+            //Nobody is waiting on a background write, so a failed one is
+            //dropped like a failed get rather than left unhandled
+            auto on_rejected = Napi::Function::New(env, [](const Napi::CallbackInfo& info) { });
+            result.ToObject().Get("catch").As<Napi::Function>().Call(result, {on_rejected});
+        }
+    } catch(Napi::Error& err) {
+        if(_flushed != nullptr) throw;
+    }
+}
+
+Napi::Value i18n::addressinput::JsDelegatedStorage::Flush(Napi::Env env) {
+    Napi::Value result = env.Undefined();
+    if(!_buffer) return result;
+
+    _flushed = &result;
+    try {
+        _buffer->Flush();
+    } catch(...) {
+        _flushed = nullptr;
+        throw;
+    }
+    _flushed = nullptr;
+    return result;
+}
+
+i18n::addressinput::PendingGets& i18n::addressinput::JsDelegatedStorage::Pending() const {
+    return _pending;
+}
+
+i18n::addressinput::SnapshotSupplier::SnapshotSupplier() : _success(false), _loaded_depth(0) { }
+
+void i18n::addressinput::SnapshotSupplier::Supply(const LookupKey& lookup_key, const Callback& supplied) {
+    supplied(_success, lookup_key, _hierarchy);
+}
+
+void i18n::addressinput::SnapshotSupplier::SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) {
+    supplied(_success, lookup_key, _hierarchy);
+}
+
+size_t i18n::addressinput::SnapshotSupplier::GetLoadedRuleDepth(const std::string& region_code) const {
+    return _loaded_depth;
+}
+
+void i18n::addressinput::SnapshotSupplier::Capture(
+        bool success,
+        const RuleHierarchy& hierarchy,
+        size_t loaded_depth,
+        std::vector<std::shared_ptr<const Rule>> pins) {
+    _success = success;
+    _hierarchy = hierarchy;
+    _loaded_depth = loaded_depth;
+    _pins = std::move(pins);
+}
+
 template<typename Key, typename Data>
 class FunctionCallbackWrapper : public i18n::addressinput::Callback<Key, Data> {
 public:
@@ -460,10 +656,15 @@ private:
 
 JsAddressValidator::JsAddressValidator(const Napi::CallbackInfo& info) 
         : Napi::ObjectWrap<JsAddressValidator>(info)
-        , _source(new i18n::addressinput::JsDelegatedSource())
-        , _storage(new i18n::addressinput::JsDelegatedStorage())
-        , _supplier(_source, _storage)
-        , _validator(&_supplier) {
+        , _storage(nullptr)
+        , _file_storage(nullptr)
+        , _preload(nullptr)
+        , _resilience(nullptr)
+        , _metrics(std::make_shared<i18n::addressinput::ValidatorMetrics>())
+        , _threaded(false)
+        , _inflight(0)
+        , _waiting(0)
+        , _cancelled(false) {
     if(info.Length() <= 0) {
         throw unexpected_type_exception(info.Env(), "Expected an object in arguments");
     }
@@ -471,45 +672,318 @@ JsAddressValidator::JsAddressValidator(const Napi::CallbackInfo& info)
     assert_typeof(info.Env(), "config", info[0], napi_valuetype::napi_object);
     auto config = info[0].ToObject();
 
+    //Owned here until they are handed to the supplier so nothing leaks if the
+    //config turns out to be invalid
+    std::unique_ptr<i18n::addressinput::JsDelegatedSource> js_source;
+    std::unique_ptr<i18n::addressinput::Source> local_source;
+    std::unique_ptr<i18n::addressinput::Storage> storage;
+
     auto source = config.Get("request");
+    auto dataset_path = config.Get("datasetPath");
     auto cache = config.Get("put");
+    auto cache_many = config.Get("putMany");
     auto retrieve = config.Get("get");
+    auto storage_path = config.Get("storagePath");
+
+    bool preload = false;
+    auto preload_opt = config.Get("preload");
+    if(!preload_opt.IsUndefined()) {
+        preload = get_value_from_napi<bool>(info.Env(), preload_opt, "preload");
+    }
+
+    if(!dataset_path.IsUndefined()) {
+        auto path = get_value_from_napi<std::string>(info.Env(), dataset_path, "datasetPath");
+        if(!source.IsUndefined()) {
+            throw Napi::Error::New(info.Env(), "'datasetPath' can not be combined with 'request'.");
+        }
 
-    if(!source.IsUndefined()) {
+        std::string error;
+        local_source.reset(i18n::addressinput::LocalDatasetSource::Open(path, preload, &error));
+        if(!local_source) {
+            throw Napi::Error::New(info.Env(), error);
+        }
+    } else if(!source.IsUndefined()) {
         assert_typeof(info.Env(), "request", source, napi_valuetype::napi_function);
-        _source->SetAcquisition(source.As<Napi::Function>());
+        js_source.reset(new i18n::addressinput::JsDelegatedSource());
+        js_source->SetAcquisition(source.As<Napi::Function>());
     } else {
         throw Napi::Error::New(info.Env(), 
-                "'request' must be specified when instantiating the validator.");
+                "'request' or 'datasetPath' must be specified when instantiating the validator.");
     }
 
-    if(!cache.IsUndefined()) {
-        assert_typeof(info.Env(), "put", cache, napi_valuetype::napi_function);
-        _storage->SetStore(cache.As<Napi::Function>());
+    if(local_source && storage_path.IsUndefined() && cache.IsUndefined() && cache_many.IsUndefined() && retrieve.IsUndefined()) {
+        //Everything is already local, there's nothing worth storing
+        storage.reset(new i18n::addressinput::NullStorage());
+    } else if(!storage_path.IsUndefined()) {
+        auto path = get_value_from_napi<std::string>(info.Env(), storage_path, "storagePath");
+        if(!cache.IsUndefined() || !cache_many.IsUndefined() || !retrieve.IsUndefined()) {
+            throw Napi::Error::New(info.Env(), "'storagePath' can not be combined with 'get', 'put' or 'putMany'.");
+        }
+
+        std::string error;
+        _file_storage = i18n::addressinput::FileStorage::Open(path, &error);
+        if(!_file_storage) {
+            throw Napi::Error::New(info.Env(), error);
+        }
+        storage.reset(_file_storage);
     } else {
-        throw Napi::Error::New(info.Env(), "'put' must be specified when instantiating the validator.");
+        std::unique_ptr<i18n::addressinput::JsDelegatedStorage> js_storage(new i18n::addressinput::JsDelegatedStorage());
+
+        if(!cache.IsUndefined()) {
+            assert_typeof(info.Env(), "put", cache, napi_valuetype::napi_function);
+            js_storage->SetStore(cache.As<Napi::Function>());
+        }
+
+        if(!cache_many.IsUndefined()) {
+            assert_typeof(info.Env(), "putMany", cache_many, napi_valuetype::napi_function);
+
+            size_t max_entries = 100;
+            double max_delay_ms = 50;
+            auto write_behind = config.Get("writeBehind");
+            if(!write_behind.IsUndefined()) {
+                assert_typeof(info.Env(), "writeBehind", write_behind, napi_valuetype::napi_object);
+                auto entries_opt = write_behind.ToObject().Get("maxEntries");
+                if(!entries_opt.IsUndefined()) {
+                    max_entries = std::max(1.0, get_value_from_napi<double>(info.Env(), entries_opt, "writeBehind.maxEntries"));
+                }
+                auto delay_opt = write_behind.ToObject().Get("maxDelayMs");
+                if(!delay_opt.IsUndefined()) {
+                    max_delay_ms = std::max(0.0, get_value_from_napi<double>(info.Env(), delay_opt, "writeBehind.maxDelayMs"));
+                }
+            }
+            js_storage->SetBatchedStore(cache_many.As<Napi::Function>(), max_entries, max_delay_ms);
+        } else if(cache.IsUndefined() && !local_source) {
+            throw Napi::Error::New(info.Env(), "'put' or 'putMany' must be specified when instantiating the validator.");
+        }
+
+        if(!retrieve.IsUndefined()) {
+            assert_typeof(info.Env(), "get", retrieve, napi_valuetype::napi_function);
+            js_storage->SetAcquisition(retrieve.As<Napi::Function>());
+        } else if(!local_source) {
+            throw Napi::Error::New(info.Env(), "'get' must be specified when instantiating the validator.");
+        }
+
+        _storage = js_storage.get();
+        storage = std::move(js_storage);
+    }
+
+    bool shared_cache = false;
+    auto shared = config.Get("sharedCache");
+    if(!shared.IsUndefined()) {
+        shared_cache = get_value_from_napi<bool>(info.Env(), shared, "sharedCache");
+    }
+
+    if(preload && shared_cache) {
+        throw Napi::Error::New(info.Env(), "'preload' and 'sharedCache' can not be combined.");
+    }
+
+    auto rule_cache = config.Get("ruleCache");
+    if(!rule_cache.IsUndefined()) {
+        if(preload || shared_cache) {
+            throw Napi::Error::New(info.Env(), "'ruleCache' can not be combined with 'preload' or 'sharedCache'.");
+        }
+
+        assert_typeof(info.Env(), "ruleCache", rule_cache, napi_valuetype::napi_object);
+        size_t max_bytes = 0;
+        auto bytes_opt = rule_cache.ToObject().Get("maxBytes");
+        if(!bytes_opt.IsUndefined()) {
+            max_bytes = std::max(0.0, get_value_from_napi<double>(info.Env(), bytes_opt, "ruleCache.maxBytes"));
+        }
+        _rule_cache = std::make_shared<i18n::addressinput::RuleCache>(max_bytes);
+    } else if(shared_cache) {
+        _rule_cache = i18n::addressinput::RuleCache::Shared();
+    }
+
+    std::optional<i18n::addressinput::ResiliencePolicy> resilience;
+    auto resilience_opt = config.Get("resilience");
+    if(!resilience_opt.IsUndefined()) {
+        resilience = get_value_from_napi<i18n::addressinput::ResiliencePolicy>(
+                info.Env(), resilience_opt, "resilience");
     }
 
-    if(!retrieve.IsUndefined()) {
-        assert_typeof(info.Env(), "get", retrieve, napi_valuetype::napi_function);
-        _storage->SetAcquisition(retrieve.As<Napi::Function>());
+    auto result_cache = config.Get("resultCache");
+    if(!result_cache.IsUndefined()) {
+        size_t max_entries = 10000;
+        size_t max_bytes = 16 * 1024 * 1024;
+
+        if(result_cache.IsObject()) {
+            auto limits = result_cache.ToObject();
+            auto entries_opt = limits.Get("maxEntries");
+            if(!entries_opt.IsUndefined()) {
+                max_entries = std::max(0.0, get_value_from_napi<double>(info.Env(), entries_opt, "resultCache.maxEntries"));
+            }
+            auto bytes_opt = limits.Get("maxBytes");
+            if(!bytes_opt.IsUndefined()) {
+                max_bytes = std::max(0.0, get_value_from_napi<double>(info.Env(), bytes_opt, "resultCache.maxBytes"));
+            }
+            _results = std::make_shared<i18n::addressinput::ResultCache>(max_entries, max_bytes);
+        } else if(get_value_from_napi<bool>(info.Env(), result_cache, "resultCache")) {
+            _results = std::make_shared<i18n::addressinput::ResultCache>(max_entries, max_bytes);
+        }
+    }
+
+    _source = js_source.get();
+
+    //Gets issued while only calls with a timeout are waiting are failed once
+    //the last of them would have timed out
+    auto get_deadline = [this]() {
+        if(_call_deadlines.empty() || _waiting > _call_deadlines.size()) {
+            return i18n::addressinput::PendingGets::Clock::time_point::max();
+        }
+        return *_call_deadlines.rbegin();
+    };
+    if(_source) _source->Pending().SetDeadline(get_deadline);
+    if(_storage) _storage->Pending().SetDeadline(get_deadline);
+
+    //Concurrent validations needing the same key share one request. The
+    //timing layers sit innermost so they measure the callbacks themselves.
+    auto coalesced_storage = new i18n::addressinput::CoalescingStorage(
+            new i18n::addressinput::TimedStorage(storage.release(), _metrics));
+    const i18n::addressinput::Source *base_source = js_source
+            ? new i18n::addressinput::TimedSource(js_source.release(), _metrics)
+            : new i18n::addressinput::TimedSource(local_source.release(), _metrics);
+    if(_results) {
+        //Innermost, so refreshes made by the resilience layer are seen too
+        base_source = new i18n::addressinput::ResultInvalidatingSource(base_source, _results);
+    }
+    i18n::addressinput::Storage *supplier_storage = coalesced_storage;
+    if(resilience) {
+        //Retries and stale refreshes go through the coalescing layer too, so
+        //a failing key is only ever being fetched once
+        auto resilient = new i18n::addressinput::ResilientSource(
+                base_source, coalesced_storage, info.Env(), *resilience);
+        _resilience = resilient;
+        base_source = resilient;
+
+        if(resilience->stale_while_revalidate) {
+            supplier_storage = resilient->Observe(coalesced_storage);
+
+            //Other suppliers hold on to the rules they parsed from the stale
+            //copy, see README
+            if(_rule_cache) {
+                auto rule_cache = _rule_cache;
+                resilient->SetRefreshed([rule_cache](const std::string& key) {
+                    rule_cache->DropRegion(key);
+                });
+            }
+        }
+    }
+    auto coalesced_source = new i18n::addressinput::CoalescingSource(base_source);
+    _source_flights = &coalesced_source->Flights();
+    _storage_flights = &coalesced_storage->Flights();
+
+    if(preload) {
+        _preload = new i18n::addressinput::PreloadingSupplier(coalesced_source, supplier_storage);
+        _supplier.reset(_preload);
+        _normalizer.reset(new i18n::addressinput::AddressNormalizer(&_preload->Preloaded()));
+        _region_builder.reset(new i18n::addressinput::RegionDataBuilder(&_preload->Preloaded()));
+    } else if(_rule_cache) {
+        _supplier.reset(new i18n::addressinput::CachingSupplier(coalesced_source, supplier_storage, _rule_cache));
     } else {
-        throw Napi::Error::New(info.Env(), "'get' must be specified when instantiating the validator.");
+        _supplier.reset(new i18n::addressinput::OndemandSupplier(coalesced_source, supplier_storage));
+    }
+    _profiling.reset(new i18n::addressinput::ProfilingSupplier(_supplier.get(), &_profile));
+    _validator.reset(new i18n::addressinput::AddressValidator(_profiling.get()));
+
+    auto threaded = config.Get("threaded");
+    if(!threaded.IsUndefined()) {
+        _threaded = get_value_from_napi<bool>(info.Env(), threaded, "threaded");
+    }
+
+    if(_threaded) {
+        //Only used to hop back onto the main thread, the JS function itself is never called
+        _completions = Napi::ThreadSafeFunction::New(
+                info.Env(),
+                Napi::Function::New(info.Env(), [](const Napi::CallbackInfo&) { }),
+                "addressinput-js validate",
+                0,
+                1);
+        _completions.Unref(info.Env());
+        _jobs = std::make_shared<JobCounter>();
+    }
+}
+
+//Validators are finalized on environment teardown even with validations still
+//in flight, e.g. when a worker thread exits. Chunks already on the pool read
+//rules this validator owns, so they are waited for first.
+JsAddressValidator::~JsAddressValidator() {
+    //Buffered puts would be lost otherwise. There is nobody left to report a
+    //failure to.
+    if(_storage) {
+        try {
+            _storage->Flush(Env());
+        } catch(...) { }
+    }
+
+    if(_threaded) {
+        _jobs->Wait();
+        _completions.Release();
+    }
+}
+
+//Keeps the event loop alive and this validator referenced while validations
+//are running on the worker pool.
+void JsAddressValidator::begin_threaded(Napi::Env env) {
+    if(_inflight++ == 0) {
+        _completions.Ref(env);
+    }
+    Ref();
+}
+
+void JsAddressValidator::end_threaded(Napi::Env env) {
+    if(--_inflight == 0) {
+        _completions.Unref(env);
     }
+    Unref();
 }
 
-Napi::FunctionReference JsAddressValidator::constructor;
+void JsAddressValidator::begin_waiting() {
+    _waiting++;
+}
+
+//Once nobody is waiting, gets still outstanding for cancelled calls are failed
+//instead of holding on to their validations until the callbacks answer, if
+//ever. Failing one can start another, e.g. the source after storage, so this
+//repeats until those validations have all finished.
+void JsAddressValidator::end_waiting(bool cancelled) {
+    _waiting--;
+    _cancelled = _cancelled || cancelled;
+    if(_waiting > 0 || !_cancelled) return;
+
+    _cancelled = false;
+    while(_waiting == 0 && ((_source && _source->Pending().Size() > 0) || (_storage && _storage->Pending().Size() > 0))) {
+        if(_source) _source->Pending().Abandon();
+        if(_storage) _storage->Pending().Abandon();
+    }
+}
 
 Napi::Object JsAddressValidator::Init(Napi::Env env, Napi::Object exports) {
     Napi::HandleScope scope(env);
 
     auto func = DefineClass(env, "AddressValidator", {
         InstanceMethod("validate", &JsAddressValidator::validate_address),
-        InstanceMethod("format", &JsAddressValidator::format_address)
+        InstanceMethod("validateMany", &JsAddressValidator::validate_many),
+        InstanceMethod("validateManyCompact", &JsAddressValidator::validate_many_compact),
+        InstanceMethod("validateParsed", &JsAddressValidator::validate_parsed),
+        InstanceMethod("validateColumns", &JsAddressValidator::validate_columns),
+        InstanceMethod("format", &JsAddressValidator::format_address),
+        InstanceMethod("formatMany", &JsAddressValidator::format_many),
+        InstanceMethod("normalize", &JsAddressValidator::normalize),
+        InstanceMethod("normalizeMany", &JsAddressValidator::normalize_many),
+        InstanceMethod("getRegionTree", &JsAddressValidator::get_region_tree),
+        InstanceMethod("suggest", &JsAddressValidator::suggest),
+        InstanceMethod("inferRegionFromPostalCode", &JsAddressValidator::infer_region),
+        InstanceMethod("preload", &JsAddressValidator::preload),
+        InstanceMethod("preloadAll", &JsAddressValidator::preload_all),
+        InstanceMethod("isLoaded", &JsAddressValidator::is_loaded),
+        InstanceMethod("exportProfile", &JsAddressValidator::export_profile),
+        InstanceMethod("prefetch", &JsAddressValidator::prefetch),
+        InstanceMethod("getStats", &JsAddressValidator::get_stats),
+        InstanceMethod("resetStats", &JsAddressValidator::reset_stats),
+        InstanceMethod("flush", &JsAddressValidator::flush)
     });
 
-    constructor = Napi::Persistent(func);
-    constructor.SuppressDestruct();
+    AddonData::For(env).validator_constructor = Napi::Persistent(func);
 
     exports.Set("AddressValidator", func);
     return exports;
@@ -528,89 +1002,1573 @@ std::ostream& operator<<(std::ostream& os, const i18n::addressinput::FieldProble
     return os;
 }
 
+Napi::Value aborted_reason(Napi::Env env, Napi::Object signal) {
+    auto reason = signal.Get("reason");
+    if(!reason.IsUndefined()) return reason;
+
+    auto error = Napi::Error::New(env, "The operation was aborted");
+    error.Value().Set("name", Napi::String::New(env, "AbortError"));
+    return error.Value();
+}
+
+Napi::Value timed_out_reason(Napi::Env env, double timeout_ms) {
+    char message[64];
+    snprintf(message, sizeof(message), "Validation timed out after %gms", timeout_ms);
+
+    auto error = Napi::Error::New(env, message);
+    error.Value().Set("name", Napi::String::New(env, "TimeoutError"));
+    return error.Value();
+}
+
+//The promise of one validate call. It settles with whichever comes first: the
+//validation finishing, the call's timeout or its AbortSignal. A validation
+//can't be interrupted once started, so a cancelled one keeps running until its
+//callbacks come back and its result is dropped. The validator stays referenced
+//until then, as libaddressinput still points into it.
+class PendingCall : public std::enable_shared_from_this<PendingCall> {
+public:
+    static std::shared_ptr<PendingCall> Start(JsAddressValidator *owner, Napi::Env env, const CallLimits& limits) {
+        std::shared_ptr<PendingCall> call(new PendingCall(owner, env, limits.timeout_ms));
+        try {
+            call->Arm(env, limits);
+        } catch(...) {
+            //Nothing will ever settle the call, so give back what it holds
+            if(!call->_settled) {
+                call->Settle();
+                owner->end_waiting(false);
+            }
+            call->Finish();
+            throw;
+        }
+        return call;
+    }
+
+    Napi::Promise Promise() const {
+        return _deferred.Promise();
+    }
+
+    Napi::Env Env() const {
+        return _deferred.Env();
+    }
+
+    //Results of a settled call are thrown away, so callers can skip building them
+    bool Settled() const {
+        return _settled;
+    }
+
+    void Resolve(Napi::Value value) {
+        if(_settled) return;
+        Settle();
+        _deferred.Resolve(value);
+        _owner->end_waiting(false);
+    }
+
+    void Reject(Napi::Value reason) {
+        if(_settled) return;
+        Settle();
+        _deferred.Reject(reason);
+        _owner->end_waiting(false);
+    }
+
+    //The native side is done with the validator
+    void Finish() {
+        _owner->Unref();
+    }
+
+private:
+    PendingCall(JsAddressValidator *owner, Napi::Env env, double timeout_ms)
+        : _owner(owner)
+        , _deferred(Napi::Promise::Deferred::New(env))
+        , _started(owner->_metrics->Begin())
+        , _settled(false) {
+        auto deadline = i18n::addressinput::PendingGets::Clock::time_point::max();
+        if(timeout_ms > 0) {
+            deadline = i18n::addressinput::PendingGets::Clock::now()
+                + std::chrono::duration_cast<i18n::addressinput::PendingGets::Clock::duration>(
+                        std::chrono::duration<double, std::milli>(timeout_ms));
+        }
+        _deadline = _owner->_call_deadlines.insert(deadline);
+
+        _owner->Ref();
+        _owner->begin_waiting();
+    }
+
+    void Arm(Napi::Env env, const CallLimits& limits) {
+        std::weak_ptr<PendingCall> weak = shared_from_this();
+
+        if(limits.signal.IsObject()) {
+            auto signal = limits.signal.ToObject();
+            if(signal.Get("aborted").ToBoolean().Value()) {
+                Cancel(aborted_reason(env, signal));
+                return;
+            }
+
+            auto listener = Napi::Function::New(env, [weak](const Napi::CallbackInfo& info) {
+                auto call = weak.lock();
+                if(call && !call->Settled()) {
+                    call->Cancel(aborted_reason(info.Env(), call->_signal.Value()));
+                }
+            });
+            auto add = signal.Get("addEventListener");
+            add.As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), listener});
+
+            _signal = Napi::Persistent(signal);
+            _listener = Napi::Persistent(listener);
+        }
+
+        if(limits.timeout_ms > 0) {
+            double timeout_ms = limits.timeout_ms;
+            _timer = Napi::Persistent(set_timeout(env, [weak, timeout_ms]() {
+                if(auto call = weak.lock()) {
+                    call->Cancel(timed_out_reason(call->Env(), timeout_ms));
+                }
+            }, timeout_ms));
+        }
+    }
+
+    void Cancel(Napi::Value reason) {
+        if(_settled) return;
+        Settle();
+        _deferred.Reject(reason);
+        _owner->end_waiting(true);
+    }
+
+    void Settle() {
+        _settled = true;
+        _owner->_metrics->End(_started);
+        _owner->_call_deadlines.erase(_deadline);
+
+        Napi::Env env = _deferred.Env();
+        if(!_timer.IsEmpty()) {
+            clear_timeout(env, _timer.Value());
+            _timer.Reset();
+        }
+        if(!_listener.IsEmpty()) {
+            auto signal = _signal.Value();
+            auto remove = signal.Get("removeEventListener");
+            if(remove.IsFunction()) {
+                remove.As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), _listener.Value()});
+            }
+            _listener.Reset();
+            _signal.Reset();
+        }
+    }
+
+    JsAddressValidator *_owner;
+    Napi::Promise::Deferred _deferred;
+    i18n::addressinput::ValidatorMetrics::Clock::time_point _started;
+    std::multiset<i18n::addressinput::PendingGets::Clock::time_point>::iterator _deadline;
+    bool _settled;
+
+    Napi::Reference<Napi::Value> _timer;
+    Napi::ObjectReference _signal;
+    Napi::FunctionReference _listener;
+};
+
+CallLimits read_call_limits(Napi::Env env, Napi::Object conf) {
+    CallLimits limits;
+
+    auto timeout = conf.Get("timeoutMs");
+    if(!timeout.IsUndefined()) {
+        limits.timeout_ms = get_value_from_napi<double>(env, timeout, "timeoutMs");
+        if(!(limits.timeout_ms >= 0)) {
+            throw Napi::Error::New(env, "'timeoutMs' must not be negative.");
+        }
+    }
+
+    limits.signal = conf.Get("signal");
+    if(!limits.signal.IsUndefined()) {
+        assert_typeof(env, "signal", limits.signal, napi_valuetype::napi_object);
+        assert_typeof(env, "signal.addEventListener",
+                limits.signal.ToObject().Get("addEventListener"), napi_valuetype::napi_function);
+    }
+
+    return limits;
+}
+
 class ValidateCallbackWrapper : public i18n::addressinput::AddressValidator::Callback {
 public:
     ValidateCallbackWrapper(
         std::shared_ptr<i18n::addressinput::AddressData> address,
         std::shared_ptr<i18n::addressinput::FieldProblemMap> problems,
         std::shared_ptr<i18n::addressinput::FieldProblemMap> filter,
-        Napi::Promise::Deferred defer
-    ) : deferred_(defer), problems(problems), filter(filter), address(address) { }
+        std::shared_ptr<PendingCall> call
+    ) : call(call), address(address), problems(problems), filter(filter) { }
 
     void operator()(
             bool success, 
             const i18n::addressinput::AddressData& data, 
             const i18n::addressinput::FieldProblemMap& problems) const override {
-        if(success) {
-            deferred_.Resolve(to_napi_value(deferred_.Env(), std::make_pair(data, problems)));
-        } else {
-            deferred_.Reject(Napi::Error::New(deferred_.Env(), "Validator call failed").Value());
+        if(success && results) {
+            results->Insert(result_key, data.region_code, problems);
         }
-        delete this;
-    }
 
-    auto Promise() {
-        return deferred_.Promise();
+        //A call that timed out or was aborted has already been rejected
+        if(!call->Settled()) {
+            if(success) {
+                call->Resolve(timed_marshal(*metrics, [&] {
+                    return to_napi_value(call->Env(), std::make_pair(data, problems));
+                }));
+            } else {
+                call->Reject(Napi::Error::New(call->Env(), "Validator call failed").Value());
+            }
+        }
+        call->Finish();
+        delete this;
     }
 
+    std::shared_ptr<PendingCall> call;
     std::shared_ptr<i18n::addressinput::AddressData> address;
     std::shared_ptr<i18n::addressinput::FieldProblemMap> problems;
     std::shared_ptr<i18n::addressinput::FieldProblemMap> filter;
-
-private:
-    Napi::Promise::Deferred deferred_;
+    std::shared_ptr<i18n::addressinput::ResultCache> results;
+    std::string result_key;
+    std::shared_ptr<i18n::addressinput::ValidatorMetrics> metrics;
 };
 
-Napi::Value JsAddressValidator::validate_address(const Napi::CallbackInfo& info) {
-    size_t argc = info.Length();
-    Napi::Value result;
-
-    if(info.Length() <= 1) {
-        throw unexpected_type_exception(info.Env(), "Expected an object in arguments");
-    }
+//Validation of one or more addresses on the worker pool. Rules are supplied on
+//the main thread through the regular Source/Storage callbacks, then the CPU
+//bound part of AddressValidator::Validate runs against a snapshot of the
+//loaded rule hierarchy on the pool. Rule objects are owned by the supplier and
+//are never freed while the validator is referenced.
+class ThreadedValidation {
+public:
+    class Supplied : public i18n::addressinput::Supplier::Callback {
+    public:
+        Supplied(ThreadedValidation *task, size_t index) : _task(task), _index(index) { }
+
+        void operator()(
+                bool success,
+                const i18n::addressinput::LookupKey& key,
+                const i18n::addressinput::Supplier::RuleHierarchy& hierarchy) const override {
+            _task->OnSupplied(_index, success, hierarchy);
+        }
 
-    auto address = get_value_from_napi<std::shared_ptr<i18n::addressinput::AddressData>>(info.Env(), info[0], "address");
-    auto conf = info[1].ToObject();
+    private:
+        ThreadedValidation *_task;
+        size_t _index;
+    };
 
-    auto allow_postal = get_value_from_napi<bool>(info.Env(), conf.Get("allow_postal"), "allow_postal");
-    auto require_name = get_value_from_napi<bool>(info.Env(), conf.Get("require_name"), "require_name");
-    auto filter = get_value_from_napi<i18n::addressinput::FieldProblemMap>(info.Env(), conf.Get("filter"), "filter");
+    class Validated : public i18n::addressinput::AddressValidator::Callback {
+    public:
+        Validated(char *success) : _success(success) { }
 
-    //Heap allocate filter due to pointer requirement
+        void operator()(
+                bool success,
+                const i18n::addressinput::AddressData& data,
+                const i18n::addressinput::FieldProblemMap& problems) const override {
+            *_success = success;
+        }
 
-    //Address isnt required as a capture but it needs to live until this callback
-    //is executed so its a cheap workaround
-    ValidateCallbackWrapper *cb = new ValidateCallbackWrapper{
-        address,
-        std::make_shared<i18n::addressinput::FieldProblemMap>(),
-        std::make_shared<i18n::addressinput::FieldProblemMap>(filter),
-        Napi::Promise::Deferred::New(info.Env())
+    private:
+        char *_success;
     };
 
-    _validator.Validate(*address, allow_postal, require_name, cb->filter.get(), cb->problems.get(), *cb);
+    ThreadedValidation(
+        JsAddressValidator *owner,
+        std::vector<i18n::addressinput::AddressData>&& addresses,
+        bool allow_postal,
+        bool require_name,
+        const i18n::addressinput::FieldProblemMap& filter,
+        bool single,
+        bool partial,
+        BatchMarshaller marshal,
+        std::shared_ptr<PendingCall> call
+    ) : _owner(owner)
+      , _completions(owner->_completions)
+      , _jobs(owner->_jobs)
+      , _addresses(std::move(addresses))
+      , _allow_postal(allow_postal)
+      , _require_name(require_name)
+      , _filter(filter)
+      , _single(single)
+      , _partial(partial)
+      , _marshal(std::move(marshal))
+      , _call(call)
+      , _keys(new i18n::addressinput::LookupKey[_addresses.size()])
+      , _snapshots(_addresses.size())
+      , _problems(_addresses.size())
+      , _success(_addresses.size(), false)
+      , _cached(_addresses.size(), false)
+      , _pending_supplies(_addresses.size())
+      , _pending_chunks(0) {
+        _supplied.reserve(_addresses.size());
+        for(size_t i = 0; i < _addresses.size(); i++) {
+            _supplied.emplace_back(this, i);
+        }
+    }
 
-    return cb->Promise();
-}
+    //Main thread. Must not touch the task after the final SupplyGlobally call
+    //as it may already have been handed to the pool.
+    void Start(Napi::Env env) {
+        _owner->begin_threaded(env);
+
+        size_t count = _addresses.size();
+        size_t cached = 0;
+        if(_owner->_results) {
+            _result_keys.reserve(count);
+            for(size_t i = 0; i < count; i++) {
+                _result_keys.push_back(i18n::addressinput::ResultCache::Key(
+                            _addresses[i], _allow_postal, _require_name, _filter));
+                if(_owner->_results->Get(_result_keys[i], &_problems[i])) {
+                    _cached[i] = _success[i] = true;
+                    cached++;
+                }
+                _owner->_metrics->ResultLookup(_addresses[i].region_code, _cached[i]);
+            }
+        }
 
-Napi::Value JsAddressValidator::format_address(const Napi::CallbackInfo& info) {
-    size_t argc = info.Length();
+        if(cached == count) {
+            Settle(env);
+            return;
+        }
 
-    if(info.Length() < 1) {
+        //Cached entries count as supplied up front so the last supply still
+        //triggers dispatch
+        _pending_supplies -= cached;
+        for(size_t i = 0; i < count; i++) {
+            if(_cached[i]) continue;
+
+            _keys[i].FromAddress(_addresses[i]);
+            _owner->_profiling->SupplyGlobally(_keys[i], _supplied[i]);
+        }
+    }
+
+private:
+    void OnSupplied(
+            size_t index,
+            bool success,
+            const i18n::addressinput::Supplier::RuleHierarchy& hierarchy) {
+        _snapshots[index].Capture(success, hierarchy,
+                _owner->_supplier->GetLoadedRuleDepth(_keys[index].ToKeyString(0)),
+                i18n::addressinput::CachingSupplier::HeldRules());
+
+        if(--_pending_supplies == 0) {
+            Dispatch();
+        }
+    }
+
+    void Dispatch() {
+        WorkerPool& pool = WorkerPool::Shared();
+        size_t count = _addresses.size();
+        size_t chunk = (count + pool.Size() - 1) / pool.Size();
+
+        _pending_chunks = (count + chunk - 1) / chunk;
+        _jobs->Begin(_pending_chunks);
+        for(size_t begin = 0; begin < count; begin += chunk) {
+            size_t end = std::min(begin + chunk, count);
+            pool.Submit([this, begin, end] { ValidateRange(begin, end); });
+        }
+    }
+
+    //Worker thread. The task may be deleted on the main thread as soon as the
+    //last chunk has posted its completion.
+    void ValidateRange(size_t begin, size_t end) {
+        std::shared_ptr<JobCounter> jobs = _jobs;
+
+        for(size_t i = begin; i < end; i++) {
+            if(_cached[i]) continue;
+
+            i18n::addressinput::AddressValidator validator(&_snapshots[i]);
+            Validated validated(&_success[i]);
+            validator.Validate(_addresses[i], _allow_postal, _require_name, &_filter, &_problems[i], validated);
+        }
+
+        if(--_pending_chunks == 0) {
+            _completions.BlockingCall(this, [](Napi::Env env, Napi::Function, ThreadedValidation *task) {
+                task->Settle(env);
+            });
+        }
+        jobs->End();
+    }
+
+    //Main thread
+    void Settle(Napi::Env env) {
+        if(_owner->_results) {
+            for(size_t i = 0; i < _addresses.size(); i++) {
+                if(_success[i] && !_cached[i]) {
+                    _owner->_results->Insert(_result_keys[i], _addresses[i].region_code, _problems[i]);
+                }
+            }
+        }
+
+        auto failed = std::find(_success.begin(), _success.end(), false);
+        if(_call->Settled()) {
+            //Timed out or aborted, the result is no longer wanted
+        } else if(failed != _success.end() && !_partial) {
+            std::string message = "Validator call failed";
+            if(!_single) {
+                message += " for address[" + std::to_string(failed - _success.begin()) + "]";
+            }
+            _call->Reject(Napi::Error::New(env, message).Value());
+        } else if(_single) {
+            _call->Resolve(timed_marshal(*_owner->_metrics, [&] {
+                return to_napi_value(env, std::make_pair(
+                            std::cref(_addresses[0]), std::cref(_problems[0])));
+            }));
+        } else {
+            _call->Resolve(timed_marshal(*_owner->_metrics, [&] {
+                return _marshal(env, _addresses, _problems, _success);
+            }));
+        }
+
+        _call->Finish();
+        _owner->end_threaded(env);
+        delete this;
+    }
+
+    JsAddressValidator *_owner;
+    Napi::ThreadSafeFunction _completions;
+    std::shared_ptr<JobCounter> _jobs;
+    std::vector<i18n::addressinput::AddressData> _addresses;
+    bool _allow_postal;
+    bool _require_name;
+    i18n::addressinput::FieldProblemMap _filter;
+    bool _single;
+    bool _partial;
+    BatchMarshaller _marshal;
+    std::shared_ptr<PendingCall> _call;
+
+    std::unique_ptr<i18n::addressinput::LookupKey[]> _keys;
+    std::vector<Supplied> _supplied;
+    std::vector<i18n::addressinput::SnapshotSupplier> _snapshots;
+    std::vector<i18n::addressinput::FieldProblemMap> _problems;
+    std::vector<char> _success;
+    std::vector<char> _cached;
+    std::vector<std::string> _result_keys;
+    size_t _pending_supplies;
+    std::atomic<size_t> _pending_chunks;
+};
+
+Napi::Value JsAddressValidator::validate_address(const Napi::CallbackInfo& info) {
+    size_t argc = info.Length();
+    Napi::Value result;
+
+    if(info.Length() <= 1) {
         throw unexpected_type_exception(info.Env(), "Expected an object in arguments");
     }
 
     auto address = get_value_from_napi<std::shared_ptr<i18n::addressinput::AddressData>>(info.Env(), info[0], "address");
+    auto conf = info[1].ToObject();
+
+    auto allow_postal = get_value_from_napi<bool>(info.Env(), conf.Get("allow_postal"), "allow_postal");
+    auto require_name = get_value_from_napi<bool>(info.Env(), conf.Get("require_name"), "require_name");
+    auto filter = get_value_from_napi<i18n::addressinput::FieldProblemMap>(info.Env(), conf.Get("filter"), "filter");
+    auto limits = read_call_limits(info.Env(), conf);
+
+    auto call = PendingCall::Start(this, info.Env(), limits);
+    if(call->Settled()) {
+        //Aborted before it started
+        call->Finish();
+        return call->Promise();
+    }
+
+    //Threaded validations check the cache themselves
+    if(_threaded) {
+        std::vector<i18n::addressinput::AddressData> addresses{*address};
+        auto task = new ThreadedValidation(
+                this, std::move(addresses), allow_postal, require_name, filter, true, false, nullptr, call);
+        task->Start(info.Env());
+        return call->Promise();
+    }
+
+    std::string result_key;
+    if(_results) {
+        result_key = i18n::addressinput::ResultCache::Key(*address, allow_postal, require_name, filter);
+
+        i18n::addressinput::FieldProblemMap problems;
+        bool hit = _results->Get(result_key, &problems);
+        _metrics->ResultLookup(address->region_code, hit);
+        if(hit) {
+            call->Resolve(timed_marshal(*_metrics, [&] {
+                return to_napi_value(info.Env(), std::make_pair(std::cref(*address), std::cref(problems)));
+            }));
+            call->Finish();
+            return call->Promise();
+        }
+    }
+
+    //Heap allocate filter due to pointer requirement
+
+    //Address isnt required as a capture but it needs to live until this callback
+    //is executed so its a cheap workaround
+    ValidateCallbackWrapper *cb = new ValidateCallbackWrapper{
+        address,
+        std::make_shared<i18n::addressinput::FieldProblemMap>(),
+        std::make_shared<i18n::addressinput::FieldProblemMap>(filter),
+        call
+    };
+    cb->results = _results;
+    cb->result_key = std::move(result_key);
+    cb->metrics = _metrics;
 
-    std::vector<std::string> lines;
-    i18n::addressinput::GetFormattedNationalAddress(*address, &lines);
+    _validator->Validate(*address, allow_postal, require_name, cb->filter.get(), cb->problems.get(), *cb);
 
-    std::stringstream ss;
-    for(auto it = lines.begin(); it != lines.end(); it++) {
-        ss << *it;
-        if(it < lines.end() - 1) {
-            ss << '\n';
+    return call->Promise();
+}
+
+//Shared state for a validateMany call. Every address gets its own callback
+//entry, and the promise is settled once the last validation reports back.
+class BatchValidation {
+public:
+    class Entry : public i18n::addressinput::AddressValidator::Callback {
+    public:
+        Entry(BatchValidation *batch, size_t index) : _batch(batch), _index(index) { }
+
+        void operator()(
+                bool success,
+                const i18n::addressinput::AddressData& data,
+                const i18n::addressinput::FieldProblemMap& problems) const override {
+            if(success && _batch->results) {
+                _batch->results->Insert(_batch->result_keys[_index], data.region_code, problems);
+            }
+            _batch->Complete(_index, success);
+        }
+
+    private:
+        BatchValidation *_batch;
+        size_t _index;
+    };
+
+    BatchValidation(
+        std::vector<i18n::addressinput::AddressData>&& addresses,
+        const i18n::addressinput::FieldProblemMap& filter,
+        bool partial,
+        BatchMarshaller marshal,
+        std::shared_ptr<PendingCall> call
+    ) : addresses(std::move(addresses))
+      , problems(this->addresses.size())
+      , filter(filter)
+      , _partial(partial)
+      , _marshal(std::move(marshal))
+      , _succeeded(this->addresses.size(), false)
+      , _remaining(this->addresses.size())
+      , _failed(false)
+      , _call(call) {
+        _entries.reserve(this->addresses.size());
+        for(size_t i = 0; i < this->addresses.size(); i++) {
+            _entries.emplace_back(this, i);
         }
-    } 
+    }
+
+    const Entry& EntryAt(size_t index) const {
+        return _entries[index];
+    }
+
+    //Called once per address. The batch deletes itself after the last one, so
+    //callers must not touch it after handing out the final entry.
+    void Complete(size_t index, bool success) {
+        _succeeded[index] = success;
+        if(!success && !_failed) {
+            _failed = true;
+            _failed_index = index;
+        }
+
+        if(--_remaining > 0) return;
+
+        Napi::Env env = _call->Env();
+        if(_call->Settled()) {
+            //Timed out or aborted, the result is no longer wanted
+        } else if(_failed && !_partial) {
+            _call->Reject(Napi::Error::New(env, "Validator call failed for address["
+                        + std::to_string(_failed_index) + "]").Value());
+        } else {
+            _call->Resolve(timed_marshal(*metrics, [&] {
+                return _marshal(env, addresses, problems, _succeeded);
+            }));
+        }
+        _call->Finish();
+        delete this;
+    }
+
+    std::vector<i18n::addressinput::AddressData> addresses;
+    std::vector<i18n::addressinput::FieldProblemMap> problems;
+    i18n::addressinput::FieldProblemMap filter;
+
+    //Set when the validator has a result cache
+    std::shared_ptr<i18n::addressinput::ResultCache> results;
+    std::vector<std::string> result_keys;
+
+    std::shared_ptr<i18n::addressinput::ValidatorMetrics> metrics;
+
+private:
+    std::vector<Entry> _entries;
+    bool _partial;
+    BatchMarshaller _marshal;
+    std::vector<char> _succeeded;
+    size_t _remaining;
+    bool _failed;
+    size_t _failed_index;
+    std::shared_ptr<PendingCall> _call;
+};
+
+Napi::Value JsAddressValidator::validate_many(const Napi::CallbackInfo& info) {
+    return validate_batch(info, ResultFormat::TUPLES);
+}
+
+Napi::Value JsAddressValidator::validate_many_compact(const Napi::CallbackInfo& info) {
+    return validate_batch(info, ResultFormat::PROBLEM_MASK);
+}
+
+Napi::Value JsAddressValidator::validate_batch(const Napi::CallbackInfo& info, ResultFormat format) {
+    if(info.Length() <= 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an array and an object in arguments");
+    }
+
+    auto addresses = get_value_from_napi<std::vector<i18n::addressinput::AddressData>>(
+            info.Env(), info[0], "addresses");
+    auto conf = info[1].ToObject();
+
+    auto allow_postal = get_value_from_napi<bool>(info.Env(), conf.Get("allow_postal"), "allow_postal");
+    auto require_name = get_value_from_napi<bool>(info.Env(), conf.Get("require_name"), "require_name");
+    auto filter = get_value_from_napi<i18n::addressinput::FieldProblemMap>(info.Env(), conf.Get("filter"), "filter");
+    auto limits = read_call_limits(info.Env(), conf);
+
+    return run_batch(info.Env(), std::move(addresses), allow_postal, require_name, filter, limits, false,
+            [format](Napi::Env env,
+                    const std::vector<i18n::addressinput::AddressData>& addresses,
+                    const std::vector<i18n::addressinput::FieldProblemMap>& problems,
+                    const std::vector<char>& succeeded) {
+                return to_napi_value(env, addresses, problems, format);
+            });
+}
+
+Napi::Value JsAddressValidator::run_batch(
+        Napi::Env env,
+        std::vector<i18n::addressinput::AddressData>&& addresses,
+        bool allow_postal,
+        bool require_name,
+        const i18n::addressinput::FieldProblemMap& filter,
+        const CallLimits& limits,
+        bool partial,
+        BatchMarshaller marshal) {
+    auto call = PendingCall::Start(this, env, limits);
+    if(call->Settled()) {
+        //Aborted before it started
+        call->Finish();
+        return call->Promise();
+    }
+
+    if(addresses.empty()) {
+        call->Resolve(timed_marshal(*_metrics, [&] {
+            return marshal(env, addresses, {}, {});
+        }));
+        call->Finish();
+        return call->Promise();
+    }
+
+    if(_threaded) {
+        auto task = new ThreadedValidation(
+                this, std::move(addresses), allow_postal, require_name, filter, false, partial, std::move(marshal), call);
+        task->Start(env);
+        return call->Promise();
+    }
+
+    size_t count = addresses.size();
+    BatchValidation *batch = new BatchValidation(std::move(addresses), filter, partial, std::move(marshal), call);
+    batch->metrics = _metrics;
+
+    if(_results) {
+        batch->results = _results;
+        batch->result_keys.reserve(count);
+        for(auto& address : batch->addresses) {
+            batch->result_keys.push_back(i18n::addressinput::ResultCache::Key(
+                        address, allow_postal, require_name, filter));
+        }
+    }
+
+    //The batch may be deleted from within the final Validate or Complete call,
+    //so nothing below may dereference it once the last entry has been handed out.
+    for(size_t i = 0; i < count; i++) {
+        if(_results) {
+            bool hit = _results->Get(batch->result_keys[i], &batch->problems[i]);
+            _metrics->ResultLookup(batch->addresses[i].region_code, hit);
+            if(hit) {
+                batch->Complete(i, true);
+                continue;
+            }
+        }
+
+        _validator->Validate(
+                batch->addresses[i],
+                allow_postal,
+                require_name,
+                &batch->filter,
+                &batch->problems[i],
+                batch->EntryAt(i));
+    }
+
+    return call->Promise();
+}
+
+i18n::addressinput::AddressColumn get_column(Napi::Env env, Napi::Value value, const std::string& name) {
+    if(!value.IsObject()) {
+        throw unexpected_type_exception(env, name, napi_valuetype::napi_object, value.Type());
+    }
+
+    auto data = value.As<Napi::Object>().Get("data");
+    auto offsets = value.As<Napi::Object>().Get("offsets");
+    if(!data.IsTypedArray() || data.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+        throw unexpected_type_exception(env, "Expected " + name + ".data to be a Uint8Array");
+    }
+    if(!offsets.IsTypedArray() || offsets.As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array) {
+        throw unexpected_type_exception(env, "Expected " + name + ".offsets to be a Uint32Array");
+    }
+
+    auto bytes = data.As<Napi::Uint8Array>();
+    auto positions = offsets.As<Napi::Uint32Array>();
+
+    i18n::addressinput::AddressColumn column;
+    column.data = std::string_view(reinterpret_cast<const char*>(bytes.Data()), bytes.ElementLength());
+    column.offsets = positions.Data();
+    column.offset_count = positions.ElementLength();
+    return column;
+}
+
+//Addresses given as one UTF-8 buffer and one offsets array per field. Each
+//field costs a couple of N-API calls for the whole batch rather than one per
+//address, and values are copied straight out of the buffers, so they may be
+//reused as soon as this returns.
+Napi::Value JsAddressValidator::validate_columns(const Napi::CallbackInfo& info) {
+    if(info.Length() <= 1) {
+        throw unexpected_type_exception(info.Env(), "Expected columns and an object in arguments");
+    }
+    assert_typeof(info.Env(), "columns", info[0], napi_valuetype::napi_object);
+
+    auto columns = info[0].As<Napi::Object>();
+    auto count = get_value_from_napi<double>(info.Env(), columns.Get("count"), "columns.count");
+    if(count < 0 || count > UINT32_MAX) {
+        throw unexpected_type_exception(info.Env(), "Expected columns.count to be a valid array length");
+    }
+
+    const PropertyNames& names = PropertyNames::For(info.Env());
+    i18n::addressinput::AddressColumns input(count);
+    for(size_t i = 0; i < i18n::addressinput::kAddressDataKeyCount; i++) {
+        auto key = static_cast<i18n::addressinput::AddressDataKey>(i);
+        auto value = columns.Get(names.DataKey(key));
+        if(value.IsUndefined()) continue;
+
+        std::string name = std::string("columns.") + i18n::addressinput::AddressDataKeyName(key);
+        std::string error;
+        if(!input.Set(key, get_column(info.Env(), value, name), &error)) {
+            throw unexpected_type_exception(info.Env(), error);
+        }
+    }
+
+    auto conf = info[1].ToObject();
+    auto allow_postal = get_value_from_napi<bool>(info.Env(), conf.Get("allow_postal"), "allow_postal");
+    auto require_name = get_value_from_napi<bool>(info.Env(), conf.Get("require_name"), "require_name");
+    auto filter = get_value_from_napi<i18n::addressinput::FieldProblemMap>(info.Env(), conf.Get("filter"), "filter");
+    auto limits = read_call_limits(info.Env(), conf);
+
+    return run_batch(info.Env(), input.ReadAll(), allow_postal, require_name, filter, limits, false,
+            [](Napi::Env env,
+                    const std::vector<i18n::addressinput::AddressData>& addresses,
+                    const std::vector<i18n::addressinput::FieldProblemMap>& problems,
+                    const std::vector<char>& succeeded) {
+                return to_napi_value(env, addresses, problems, ResultFormat::PROBLEM_MASK);
+            });
+}
+
+//Validates up to max records taken from an AddressParser. Resolves with
+//{ first, masks, errors }: the stream index of the first record, problem masks
+//for every record taken, and { record, line, message } for those that
+//couldn't be parsed or whose rules couldn't be loaded, whose masks are left
+//empty.
+Napi::Value JsAddressValidator::validate_parsed(const Napi::CallbackInfo& info) {
+    if(info.Length() <= 2) {
+        throw unexpected_type_exception(info.Env(), "Expected a parser, a count and an object in arguments");
+    }
+
+    auto& parser = JsAddressParser::FromValue(info.Env(), info[0]);
+    auto max = get_value_from_napi<double>(info.Env(), info[1], "max");
+    auto conf = info[2].ToObject();
+
+    auto allow_postal = get_value_from_napi<bool>(info.Env(), conf.Get("allow_postal"), "allow_postal");
+    auto require_name = get_value_from_napi<bool>(info.Env(), conf.Get("require_name"), "require_name");
+    auto filter = get_value_from_napi<i18n::addressinput::FieldProblemMap>(info.Env(), conf.Get("filter"), "filter");
+
+    uint64_t first = parser.Taken();
+    auto records = parser.Take(max > 0 ? size_t(max) : 0);
+
+    //Only parsed records are validated, positions maps them back
+    std::vector<i18n::addressinput::AddressData> addresses;
+    auto positions = std::make_shared<std::vector<uint32_t>>();
+    auto lines = std::make_shared<std::vector<uint64_t>>();
+    auto failed = std::make_shared<std::vector<i18n::addressinput::ParsedRecord>>();
+    auto failed_positions = std::make_shared<std::vector<uint32_t>>();
+
+    addresses.reserve(records.size());
+    positions->reserve(records.size());
+    lines->reserve(records.size());
+    for(uint32_t i = 0; i < records.size(); i++) {
+        if(records[i].error.empty()) {
+            addresses.push_back(std::move(records[i].address));
+            positions->push_back(i);
+            lines->push_back(records[i].line);
+        } else {
+            failed->push_back(std::move(records[i]));
+            failed_positions->push_back(i);
+        }
+    }
+
+    //Partial, so a record whose rules can't be loaded is reported along with
+    //the ones that couldn't be parsed instead of failing the whole batch
+    size_t count = records.size();
+    return run_batch(info.Env(), std::move(addresses), allow_postal, require_name, filter, CallLimits(), true,
+            [first, count, positions, lines, failed, failed_positions](
+                    Napi::Env env,
+                    const std::vector<i18n::addressinput::AddressData>& addresses,
+                    const std::vector<i18n::addressinput::FieldProblemMap>& problems,
+                    const std::vector<char>& succeeded) {
+                auto masks = Napi::Uint32Array::New(env, count * i18n::addressinput::kProblemMaskWords);
+                uint32_t *words = masks.Data();
+                for(size_t i = 0; i < problems.size(); i++) {
+                    if(!succeeded[i]) {
+                        i18n::addressinput::ParsedRecord record;
+                        record.line = (*lines)[i];
+                        record.error = "Failed to load rules for region " + addresses[i].region_code;
+                        failed->push_back(std::move(record));
+                        failed_positions->push_back((*positions)[i]);
+                        continue;
+                    }
+                    i18n::addressinput::WriteProblemMask(
+                            problems[i], words + (*positions)[i] * i18n::addressinput::kProblemMaskWords);
+                }
+
+                //In record order
+                std::vector<size_t> order(failed->size());
+                for(size_t i = 0; i < order.size(); i++) order[i] = i;
+                std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                    return (*failed_positions)[a] < (*failed_positions)[b];
+                });
+
+                Napi::Array errors = Napi::Array::New(env, failed->size());
+                for(uint32_t i = 0; i < order.size(); i++) {
+                    Napi::Object error = Napi::Object::New(env);
+                    error.Set("record", Napi::Number::New(env, double(first + (*failed_positions)[order[i]])));
+                    error.Set("line", Napi::Number::New(env, double((*failed)[order[i]].line)));
+                    error.Set("message", Napi::String::New(env, (*failed)[order[i]].error));
+                    errors.Set(i, error);
+                }
+
+                Napi::Object ret = Napi::Object::New(env);
+                ret.Set("first", Napi::Number::New(env, double(first)));
+                ret.Set("masks", masks);
+                ret.Set("errors", errors);
+                return Napi::Value(ret);
+            });
+}
+
+Napi::Value JsAddressValidator::format_address(const Napi::CallbackInfo& info) {
+    size_t argc = info.Length();
+
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an object in arguments");
+    }
+
+    auto address = get_value_from_napi<i18n::addressinput::AddressData>(info.Env(), info[0], "address");
+
+    i18n::addressinput::AddressFormatter formatter(i18n::addressinput::FormatStyle::NATIONAL);
+    return to_napi_value(info.Env(), formatter.Joined(address));
+}
+
+//Formats a batch with one formatter, so its buffers are reused for every
+//address. Resolves each address to a string, lines joined by '\n', or to its
+//array of lines.
+Napi::Value JsAddressValidator::format_many(const Napi::CallbackInfo& info) {
+    if(info.Length() <= 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an array and an object in arguments");
+    }
+
+    auto addresses = get_value_from_napi<std::vector<i18n::addressinput::AddressData>>(
+            info.Env(), info[0], "addresses");
+    auto conf = info[1].ToObject();
+
+    auto style_name = get_value_from_napi<std::string>(info.Env(), conf.Get("style"), "style");
+    i18n::addressinput::FormatStyle style;
+    if(!i18n::addressinput::ParseFormatStyle(style_name, &style)) {
+        throw unexpected_type_exception(info.Env(), "Expected one of national|latin|single_line|street, recieved " + style_name);
+    }
+    auto as_lines = get_value_from_napi<bool>(info.Env(), conf.Get("lines"), "lines");
+
+    i18n::addressinput::AddressFormatter formatter(style);
+    Napi::Array ret = Napi::Array::New(info.Env(), addresses.size());
+    for(uint32_t i = 0; i < addresses.size(); i++) {
+        if(as_lines) {
+            ret.Set(i, to_napi_value(info.Env(), formatter.Lines(addresses[i])));
+        } else {
+            ret.Set(i, to_napi_value(info.Env(), formatter.Joined(addresses[i])));
+        }
+    }
+
+    return ret;
+}
+
+Napi::Value JsAddressValidator::normalize(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an object in arguments");
+    }
+
+    std::vector<i18n::addressinput::AddressData> addresses{
+        get_value_from_napi<i18n::addressinput::AddressData>(info.Env(), info[0], "address")};
+    return normalize_batch(info.Env(), std::move(addresses), true);
+}
+
+Napi::Value JsAddressValidator::normalize_many(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an array in arguments");
+    }
+
+    auto addresses = get_value_from_napi<std::vector<i18n::addressinput::AddressData>>(
+            info.Env(), info[0], "addresses");
+    return normalize_batch(info.Env(), std::move(addresses), false);
+}
+
+//AddressNormalizer only works on loaded regions, so every region the batch
+//needs is loaded first and the whole batch is normalized in one pass once the
+//last one is in. Addresses of regions that fail to load come back unchanged.
+Napi::Value JsAddressValidator::normalize_batch(
+        Napi::Env env,
+        std::vector<i18n::addressinput::AddressData>&& addresses,
+        bool single) {
+    auto& supplier = preloading(env);
+    auto deferred = Napi::Promise::Deferred::New(env);
+
+    struct Normalization {
+        std::vector<i18n::addressinput::AddressData> addresses;
+        size_t remaining;
+    };
+    auto task = std::make_shared<Normalization>(Normalization{std::move(addresses), 0});
+
+    auto finish = [this, task, deferred, single]() {
+        for(auto& address : task->addresses) {
+            if(!address.region_code.empty() && _preload->IsLoaded(address.region_code)) {
+                _normalizer->Normalize(&address);
+            }
+        }
+
+        Napi::Env env = deferred.Env();
+        if(single) {
+            deferred.Resolve(to_napi_value(env, task->addresses[0]));
+            return;
+        }
+
+        Napi::Array ret = Napi::Array::New(env, task->addresses.size());
+        for(uint32_t i = 0; i < task->addresses.size(); i++) {
+            ret.Set(i, to_napi_value(env, task->addresses[i]));
+        }
+        deferred.Resolve(ret);
+    };
+
+    std::set<std::string> regions;
+    for(auto& address : task->addresses) {
+        if(!address.region_code.empty()) regions.insert(address.region_code);
+    }
+
+    if(regions.empty()) {
+        finish();
+        return deferred.Promise();
+    }
+
+    task->remaining = regions.size();
+    Ref();
+    begin_waiting();
+    for(const auto& region_code : regions) {
+        supplier.Load(region_code, [this, task, finish](bool success, int num_rules) {
+            if(--task->remaining > 0) return;
+
+            finish();
+            end_waiting(false);
+            Unref();
+        });
+    }
+
+    return deferred.Promise();
+}
+
+//{ key, name, subRegions } with every sub region frozen. The node itself is
+//left for the caller to freeze.
+Napi::Object to_napi_value(Napi::Env env, const i18n::addressinput::RegionData& region) {
+    const auto& sub_regions = region.sub_regions();
+    Napi::Array children = Napi::Array::New(env, sub_regions.size());
+    for(uint32_t i = 0; i < sub_regions.size(); i++) {
+        Napi::Object child = to_napi_value(env, *sub_regions[i]);
+        child.Freeze();
+        children.Set(i, child);
+    }
+    children.Freeze();
+
+    Napi::Object ret = Napi::Object::New(env);
+    ret.Set("key", Napi::String::New(env, region.key()));
+    ret.Set("name", Napi::String::New(env, region.name()));
+    ret.Set("subRegions", children);
+    return ret;
+}
+
+//Trees are built once per region and language and the same frozen object is
+//handed out from then on
+Napi::Value JsAddressValidator::region_tree(Napi::Env env, const std::string& region_code, const std::string& language) {
+    std::string cache_key = region_code + '\n' + language;
+    auto cached = _region_trees.find(cache_key);
+    if(cached != _region_trees.end()) {
+        return cached->second.Value();
+    }
+
+    std::string best_language;
+    const auto& region = _region_builder->Build(region_code, language, &best_language);
+
+    Napi::Object tree = to_napi_value(env, region);
+    tree.Set("language", Napi::String::New(env, best_language));
+    tree.Freeze();
+
+    _region_trees.emplace(cache_key, Napi::Persistent(tree));
+    return tree;
+}
+
+//Resolves with the region's tree of sub regions, loading the region first if
+//needed. Requires a preloading validator, as RegionDataBuilder does.
+Napi::Value JsAddressValidator::get_region_tree(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected a region code in arguments");
+    }
+
+    auto& supplier = preloading(info.Env());
+    auto region_code = get_value_from_napi<std::string>(info.Env(), info[0], "regionCode");
+    std::string language;
+    if(info.Length() > 1 && !info[1].IsUndefined()) {
+        language = get_value_from_napi<std::string>(info.Env(), info[1], "language");
+    }
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+    Ref();
+    begin_waiting();
+    supplier.Load(region_code, [this, deferred, region_code, language](bool success, int num_rules) {
+        if(success) {
+            deferred.Resolve(region_tree(deferred.Env(), region_code, language));
+        } else {
+            deferred.Reject(Napi::Error::New(deferred.Env(),
+                        "Failed to load rules for region " + region_code).Value());
+        }
+        end_waiting(false);
+        Unref();
+    });
+
+    return deferred.Promise();
+}
+
+bool equals_ignore_case(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); });
+}
+
+//Matches a sub region by key, or by name ignoring ASCII case
+const i18n::addressinput::RegionData* find_sub_region(
+        const i18n::addressinput::RegionData& parent, const std::string& value) {
+    for(const auto* region : parent.sub_regions()) {
+        if(region->key() == value || equals_ignore_case(region->name(), value)) return region;
+    }
+    return nullptr;
+}
+
+//Both trees come from the same rules, so sub regions are usually at the same
+//position in each
+const i18n::addressinput::RegionData* find_same_region(
+        const i18n::addressinput::RegionData& parent, size_t index, const std::string& key) {
+    const auto& sub_regions = parent.sub_regions();
+    if(index < sub_regions.size() && sub_regions[index]->key() == key) return sub_regions[index];
+    return find_sub_region(parent, key);
+}
+
+//Ranks the sub regions a field can hold against its value. The fields above
+//it pick which list that is, matched by key, name or Latin name. Indexes are
+//built on first use and kept for the validator's lifetime.
+Napi::Value JsAddressValidator::suggestions(
+        Napi::Env env,
+        const i18n::addressinput::AddressData& address,
+        i18n::addressinput::AddressField field,
+        size_t limit) {
+    std::string language;
+    const auto* node = &_region_builder->Build(address.region_code, address.language_code, &language);
+
+    //Names in Latin script where the region has them, e.g. "Tokyo" for JP
+    const i18n::addressinput::RegionData* latin = nullptr;
+    if(!language.empty()) {
+        std::string latin_language;
+        latin = &_region_builder->Build(address.region_code,
+                language.substr(0, language.find('-')) + "-Latn", &latin_language);
+        if(latin_language == language) latin = nullptr;
+    }
+
+    std::string cache_key = address.region_code + '\n' + language;
+    for(int parent = i18n::addressinput::ADMIN_AREA; parent < field; parent++) {
+        const auto& value = address.GetFieldValue(static_cast<i18n::addressinput::AddressField>(parent));
+        const auto* child = find_sub_region(*node, value);
+        const auto* latin_child = latin == nullptr ? nullptr : find_sub_region(*latin, child ? child->key() : value);
+        if(child == nullptr && latin_child != nullptr) {
+            child = find_sub_region(*node, latin_child->key());
+        }
+        if(child == nullptr) {
+            return Napi::Array::New(env);
+        }
+
+        node = child;
+        latin = latin_child;
+        cache_key += '\n' + child->key();
+    }
+
+    const auto& sub_regions = node->sub_regions();
+    auto index = _suggestion_indexes.find(cache_key);
+    if(index == _suggestion_indexes.end()) {
+        i18n::addressinput::SuggestionIndex built;
+        for(size_t i = 0; i < sub_regions.size(); i++) {
+            const auto* region = sub_regions[i];
+            const auto* latin_region = latin == nullptr ? nullptr : find_same_region(*latin, i, region->key());
+            built.Add({region->key(), region->name(), latin_region ? latin_region->name() : std::string()});
+        }
+        index = _suggestion_indexes.emplace(cache_key, std::move(built)).first;
+    }
+
+    auto found = index->second.Suggest(address.GetFieldValue(field), limit);
+    Napi::Array ret = Napi::Array::New(env, found.size());
+    for(uint32_t i = 0; i < found.size(); i++) {
+        const auto* region = sub_regions[found[i].candidate];
+        Napi::Object suggestion = Napi::Object::New(env);
+        suggestion.Set("key", Napi::String::New(env, region->key()));
+        suggestion.Set("name", Napi::String::New(env, region->name()));
+        suggestion.Set("distance", Napi::Number::New(env, found[i].distance));
+        ret.Set(i, suggestion);
+    }
+    return ret;
+}
+
+//Resolves with the sub regions closest to what a field holds, e.g. for an
+//UNKNOWN_VALUE problem. Requires a preloading validator.
+Napi::Value JsAddressValidator::suggest(const Napi::CallbackInfo& info) {
+    if(info.Length() < 2) {
+        throw unexpected_type_exception(info.Env(), "Expected an address and a field in arguments");
+    }
+
+    auto& supplier = preloading(info.Env());
+    auto address = get_value_from_napi<i18n::addressinput::AddressData>(info.Env(), info[0], "address");
+    auto field = strtofield(info.Env(), get_value_from_napi<std::string>(info.Env(), info[1], "field"));
+    if(field != i18n::addressinput::ADMIN_AREA
+            && field != i18n::addressinput::LOCALITY
+            && field != i18n::addressinput::DEPENDENT_LOCALITY) {
+        throw unexpected_type_exception(info.Env(), "Expected one of ADMIN_AREA|LOCALITY|DEPENDENT_LOCALITY");
+    }
+
+    size_t limit = 5;
+    if(info.Length() > 2 && !info[2].IsUndefined()) {
+        limit = std::max(0.0, get_value_from_napi<double>(info.Env(), info[2], "limit"));
+    }
+
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+    if(address.region_code.empty()) {
+        deferred.Resolve(Napi::Array::New(info.Env()));
+        return deferred.Promise();
+    }
+
+    Ref();
+    begin_waiting();
+    supplier.Load(address.region_code, [this, deferred, address, field, limit](bool success, int num_rules) {
+        if(success) {
+            deferred.Resolve(suggestions(deferred.Env(), address, field, limit));
+        } else {
+            deferred.Reject(Napi::Error::New(deferred.Env(),
+                        "Failed to load rules for region " + address.region_code).Value());
+        }
+        end_waiting(false);
+        Unref();
+    });
+
+    return deferred.Promise();
+}
+
+//Resolves with the sub region keys a postal code implies, as address fields.
+//The index is built from the rules' compiled zip patterns the first time a
+//region is asked about. Requires a preloading validator, as only
+//PreloadSupplier hands out a region's rules.
+Napi::Value JsAddressValidator::infer_region(const Napi::CallbackInfo& info) {
+    if(info.Length() < 2) {
+        throw unexpected_type_exception(info.Env(), "Expected a region code and a postal code in arguments");
+    }
+
+    auto& supplier = preloading(info.Env());
+    auto region_code = get_value_from_napi<std::string>(info.Env(), info[0], "regionCode");
+    auto postal_code = get_value_from_napi<std::string>(info.Env(), info[1], "postalCode");
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+    Ref();
+    begin_waiting();
+    supplier.Load(region_code, [this, deferred, region_code, postal_code](bool success, int num_rules) {
+        Napi::Env env = deferred.Env();
+        if(!success) {
+            deferred.Reject(Napi::Error::New(env, "Failed to load rules for region " + region_code).Value());
+            end_waiting(false);
+            Unref();
+            return;
+        }
+
+        auto& index = _postal_indexes[region_code];
+        if(index == nullptr) {
+            std::map<std::string, std::string> patterns;
+            for(const auto& item : _preload->Preloaded().GetRulesForRegion(region_code)) {
+                const auto* matcher = item.second->GetPostalCodeMatcher();
+                if(matcher != nullptr) patterns.emplace(item.first, matcher->ptr->pattern());
+            }
+            index.reset(new i18n::addressinput::PostalCodeIndex("data/" + region_code, patterns));
+        }
+
+        static const char* const kFields[] = {"administrative_area", "locality", "dependent_locality"};
+        auto keys = index->Infer(postal_code);
+        Napi::Object ret = Napi::Object::New(env);
+        for(size_t i = 0; i < keys.size() && i < sizeof(kFields) / sizeof(*kFields); i++) {
+            ret.Set(kFields[i], Napi::String::New(env, keys[i]));
+        }
+        deferred.Resolve(ret);
+        end_waiting(false);
+        Unref();
+    });
+
+    return deferred.Promise();
+}
+
+i18n::addressinput::PreloadingSupplier& JsAddressValidator::preloading(Napi::Env env) {
+    if(_preload == nullptr) {
+        throw Napi::Error::New(env, "Region preloading requires a validator created with 'preload: true'.");
+    }
+    return *_preload;
+}
+
+Napi::Value JsAddressValidator::preload(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected a region code in arguments");
+    }
+
+    auto& supplier = preloading(info.Env());
+    auto region_code = get_value_from_napi<std::string>(info.Env(), info[0], "regionCode");
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+    Ref();
+    begin_waiting();
+    supplier.Load(region_code, [this, deferred, region_code](bool success, int num_rules) {
+        if(success) {
+            deferred.Resolve(Napi::Number::New(deferred.Env(), num_rules));
+        } else {
+            deferred.Reject(Napi::Error::New(deferred.Env(),
+                        "Failed to load rules for region " + region_code).Value());
+        }
+        end_waiting(false);
+        Unref();
+    });
+
+    return deferred.Promise();
+}
+
+Napi::Value JsAddressValidator::preload_all(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected an array of region codes in arguments");
+    }
+
+    auto& supplier = preloading(info.Env());
+    auto region_codes = get_value_from_napi<std::vector<std::string>>(info.Env(), info[0], "regionCodes");
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+
+    if(region_codes.empty()) {
+        deferred.Resolve(Napi::Number::New(info.Env(), 0));
+        return deferred.Promise();
+    }
+
+    struct Progress {
+        size_t remaining;
+        int num_rules;
+        std::vector<std::string> failed;
+    };
+    auto progress = std::make_shared<Progress>(Progress{region_codes.size(), 0, {}});
+
+    Ref();
+    begin_waiting();
+    for(const auto& region_code : region_codes) {
+        supplier.Load(region_code, [this, deferred, progress, region_code](bool success, int num_rules) {
+            if(success) {
+                progress->num_rules += num_rules;
+            } else {
+                progress->failed.push_back(region_code);
+            }
+
+            if(--progress->remaining > 0) return;
+
+            if(progress->failed.empty()) {
+                deferred.Resolve(Napi::Number::New(deferred.Env(), progress->num_rules));
+            } else {
+                std::string regions;
+                for(const auto& failed : progress->failed) {
+                    regions += (regions.empty() ? "" : ", ") + failed;
+                }
+                deferred.Reject(Napi::Error::New(deferred.Env(),
+                            "Failed to load rules for regions " + regions).Value());
+            }
+            end_waiting(false);
+            Unref();
+        });
+    }
+
+    return deferred.Promise();
+}
+
+Napi::Value JsAddressValidator::is_loaded(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1) {
+        throw unexpected_type_exception(info.Env(), "Expected a region code in arguments");
+    }
+
+    auto region_code = get_value_from_napi<std::string>(info.Env(), info[0], "regionCode");
+    return Napi::Boolean::New(info.Env(), preloading(info.Env()).IsLoaded(region_code));
+}
+
+Napi::Value JsAddressValidator::export_profile(const Napi::CallbackInfo& info) {
+    size_t limit = _profile.Size();
+    if(info.Length() > 0 && !info[0].IsUndefined()) {
+        limit = std::max(0.0, get_value_from_napi<double>(info.Env(), info[0], "limit"));
+    }
+
+    auto hottest = _profile.Hottest(limit);
+    Napi::Array ret = Napi::Array::New(info.Env(), hottest.size());
+    for(uint32_t i = 0; i < hottest.size(); i++) {
+        Napi::Object entry = Napi::Object::New(info.Env());
+        entry.Set("key", Napi::String::New(info.Env(), hottest[i].first));
+        entry.Set("count", Napi::Number::New(info.Env(), double(hottest[i].second)));
+        ret.Set(i, entry);
+    }
+    return ret;
+}
+
+//Loads the rules of a profile's keys, hottest first, with at most concurrency
+//lookups outstanding at once. Deletes itself once every key has been supplied.
+class Prefetch {
+public:
+    class Supplied : public i18n::addressinput::Supplier::Callback {
+    public:
+        explicit Supplied(Prefetch *task) : _task(task) { }
+
+        void operator()(
+                bool success,
+                const i18n::addressinput::LookupKey& key,
+                const i18n::addressinput::Supplier::RuleHierarchy& hierarchy) const override {
+            _task->OnSupplied(success);
+        }
+
+    private:
+        Prefetch *_task;
+    };
+
+    Prefetch(
+        JsAddressValidator *owner,
+        const std::vector<i18n::addressinput::AddressData>& addresses,
+        size_t concurrency,
+        Napi::Promise::Deferred deferred
+    ) : _owner(owner)
+      , _keys(new i18n::addressinput::LookupKey[addresses.size()])
+      , _count(addresses.size())
+      , _concurrency(std::max<size_t>(1, concurrency))
+      , _deferred(deferred)
+      , _supplied(this)
+      , _next(0)
+      , _active(0)
+      , _loaded(0)
+      , _pumping(false) {
+        for(size_t i = 0; i < _count; i++) {
+            _keys[i].FromAddress(addresses[i]);
+        }
+    }
+
+    void Start() {
+        _owner->Ref();
+        _owner->begin_waiting();
+        Pump();
+    }
+
+private:
+    //Supplies answered from cache call back before Supply returns, so the
+    //loop keeps going rather than recursing once per key
+    void Pump() {
+        if(_pumping) return;
+        _pumping = true;
+        while(_next < _count && _active < _concurrency) {
+            _active++;
+            _owner->_supplier->Supply(_keys[_next++], _supplied);
+        }
+        _pumping = false;
+
+        if(_active == 0 && _next == _count) Finish();
+    }
+
+    void OnSupplied(bool success) {
+        _active--;
+        if(success) _loaded++;
+        Pump();
+    }
+
+    void Finish() {
+        _deferred.Resolve(Napi::Number::New(_deferred.Env(), double(_loaded)));
+        _owner->end_waiting(false);
+        _owner->Unref();
+        delete this;
+    }
+
+    JsAddressValidator *_owner;
+    std::unique_ptr<i18n::addressinput::LookupKey[]> _keys;
+    size_t _count;
+    size_t _concurrency;
+    Napi::Promise::Deferred _deferred;
+    Supplied _supplied;
+    size_t _next;
+    size_t _active;
+    size_t _loaded;
+    bool _pumping;
+};
+
+Napi::Value JsAddressValidator::prefetch(const Napi::CallbackInfo& info) {
+    if(info.Length() < 1 || !info[0].IsArray()) {
+        throw unexpected_type_exception(info.Env(), "Expected an array of profile entries in arguments");
+    }
+
+    size_t concurrency = 4;
+    size_t limit = SIZE_MAX;
+    if(info.Length() > 1 && !info[1].IsUndefined()) {
+        assert_typeof(info.Env(), "opts", info[1], napi_valuetype::napi_object);
+        auto opts = info[1].ToObject();
+        auto concurrency_opt = opts.Get("concurrency");
+        if(!concurrency_opt.IsUndefined()) {
+            concurrency = std::max(1.0, get_value_from_napi<double>(info.Env(), concurrency_opt, "opts.concurrency"));
+        }
+        auto limit_opt = opts.Get("limit");
+        if(!limit_opt.IsUndefined()) {
+            limit = std::max(0.0, get_value_from_napi<double>(info.Env(), limit_opt, "opts.limit"));
+        }
+    }
+
+    //Hottest first, keeping the profile's own order among equal counts
+    auto profile = info[0].As<Napi::Array>();
+    std::vector<std::pair<double, std::string>> entries;
+    entries.reserve(profile.Length());
+    for(uint32_t i = 0; i < profile.Length(); i++) {
+        Napi::Value entry = profile.Get(i);
+        assert_typeof(info.Env(), "profile[" + std::to_string(i) + "]", entry, napi_valuetype::napi_object);
+        auto key = get_value_from_napi<std::string>(info.Env(), entry.ToObject().Get("key"), "key");
+        auto count_opt = entry.ToObject().Get("count");
+        double count = count_opt.IsUndefined() ? 1 : get_value_from_napi<double>(info.Env(), count_opt, "count");
+        entries.emplace_back(count, std::move(key));
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::set<std::string> seen;
+    std::vector<i18n::addressinput::AddressData> addresses;
+    for(const auto& entry : entries) {
+        if(addresses.size() >= limit) break;
+
+        i18n::addressinput::AddressData address;
+        if(!seen.insert(entry.second).second || !i18n::addressinput::AccessProfile::ToAddress(entry.second, &address)) continue;
+        addresses.push_back(std::move(address));
+    }
+
+    auto deferred = Napi::Promise::Deferred::New(info.Env());
+    (new Prefetch(this, addresses, concurrency, deferred))->Start();
+    return deferred.Promise();
+}
+
+Napi::Value to_napi_value(Napi::Env env, const i18n::addressinput::SingleFlight& flights) {
+    Napi::Object ret = Napi::Object::New(env);
+    ret.Set("requests", Napi::Number::New(env, flights.Requests()));
+    ret.Set("coalesced", Napi::Number::New(env, flights.Coalesced()));
+    return ret;
+}
+
+//Cumulative bucket counts, one per bound in kLatencyBoundsUs, so they map
+//straight onto Prometheus "le" buckets. count is the +Inf bucket.
+Napi::Value to_napi_value(Napi::Env env, const i18n::addressinput::LatencyHistogram& histogram) {
+    Napi::Array buckets = Napi::Array::New(env, i18n::addressinput::kLatencyBounds);
+    uint64_t total = 0;
+    for(uint32_t i = 0; i < i18n::addressinput::kLatencyBounds; i++) {
+        total += histogram.Bucket(i);
+        buckets.Set(i, Napi::Number::New(env, double(total)));
+    }
+
+    Napi::Object ret = Napi::Object::New(env);
+    ret.Set("count", Napi::Number::New(env, double(histogram.Count())));
+    ret.Set("sumMs", Napi::Number::New(env, histogram.SumUs() / 1000.0));
+    ret.Set("buckets", buckets);
+    return ret;
+}
+
+Napi::Value JsAddressValidator::get_stats(const Napi::CallbackInfo& info) {
+    Napi::Object stats = Napi::Object::New(info.Env());
+
+    Napi::Object validations = Napi::Object::New(info.Env());
+    validations.Set("count", Napi::Number::New(info.Env(), double(_metrics->validations.load())));
+    validations.Set("inflight", Napi::Number::New(info.Env(), double(_metrics->inflight.load())));
+    validations.Set("latency", to_napi_value(info.Env(), _metrics->validate));
+    validations.Set("marshalling", to_napi_value(info.Env(), _metrics->marshal));
+    stats.Set("validations", validations);
+
+    auto source = to_napi_value(info.Env(), *_source_flights).As<Napi::Object>();
+    source.Set("retries", Napi::Number::New(info.Env(), _resilience ? _resilience->Retries() : 0));
+    source.Set("failures", Napi::Number::New(info.Env(), _resilience ? _resilience->Failures() : 0));
+    source.Set("negativeHits", Napi::Number::New(info.Env(), _resilience ? _resilience->NegativeHits() : 0));
+    source.Set("staleServed", Napi::Number::New(info.Env(), _resilience ? _resilience->StaleServed() : 0));
+    source.Set("refreshes", Napi::Number::New(info.Env(), _resilience ? _resilience->Refreshes() : 0));
+    source.Set("calls", Napi::Number::New(info.Env(), double(_metrics->source_gets.load())));
+    source.Set("latency", to_napi_value(info.Env(), _metrics->source_wait));
+    stats.Set("source", source);
+
+    auto storage = to_napi_value(info.Env(), *_storage_flights).As<Napi::Object>();
+    storage.Set("calls", Napi::Number::New(info.Env(), double(_metrics->storage_gets.load())));
+    storage.Set("puts", Napi::Number::New(info.Env(), double(_metrics->storage_puts.load())));
+    storage.Set("latency", to_napi_value(info.Env(), _metrics->storage_wait));
+    storage.Set("writeErrors", Napi::Number::New(info.Env(), _file_storage ? double(_file_storage->WriteErrors()) : 0));
+    stats.Set("storage", storage);
+
+    Napi::Object results = Napi::Object::New(info.Env());
+    results.Set("hits", Napi::Number::New(info.Env(), _results ? _results->Hits() : 0));
+    results.Set("misses", Napi::Number::New(info.Env(), _results ? _results->Misses() : 0));
+    results.Set("evictions", Napi::Number::New(info.Env(), _results ? _results->Evictions() : 0));
+    results.Set("entries", Napi::Number::New(info.Env(), _results ? _results->Size() : 0));
+    results.Set("bytes", Napi::Number::New(info.Env(), _results ? _results->Bytes() : 0));
+    stats.Set("results", results);
+
+    Napi::Object rules = Napi::Object::New(info.Env());
+    rules.Set("entries", Napi::Number::New(info.Env(), _rule_cache ? _rule_cache->Size() : 0));
+    rules.Set("bytes", Napi::Number::New(info.Env(), _rule_cache ? _rule_cache->Bytes() : 0));
+    rules.Set("maxBytes", Napi::Number::New(info.Env(), _rule_cache ? _rule_cache->MaxBytes() : 0));
+    rules.Set("evictions", Napi::Number::New(info.Env(), _rule_cache ? double(_rule_cache->Evictions()) : 0));
+    stats.Set("rules", rules);
+
+    Napi::Object regions = Napi::Object::New(info.Env());
+    for(auto& item : _metrics->Regions()) {
+        Napi::Object region = Napi::Object::New(info.Env());
+        region.Set("ruleHits", Napi::Number::New(info.Env(), double(item.second.rule_hits)));
+        region.Set("ruleMisses", Napi::Number::New(info.Env(), double(item.second.rule_misses)));
+        region.Set("resultHits", Napi::Number::New(info.Env(), double(item.second.result_hits)));
+        region.Set("resultMisses", Napi::Number::New(info.Env(), double(item.second.result_misses)));
+        regions.Set(item.first, region);
+    }
+    stats.Set("regions", regions);
+    return stats;
+}
+
+//Zeroes every counter and histogram reported by getStats. Gauges, like the
+//result cache's size and the validations in flight, are left alone.
+Napi::Value JsAddressValidator::reset_stats(const Napi::CallbackInfo& info) {
+    _metrics->Reset();
+    _source_flights->ResetCounters();
+    _storage_flights->ResetCounters();
+    if(_resilience) _resilience->ResetCounters();
+    if(_results) _results->ResetCounters();
+    if(_rule_cache) _rule_cache->ResetCounters();
+    return info.Env().Undefined();
+}
 
-    return to_napi_value(info.Env(), ss.str());
+Napi::Value JsAddressValidator::flush(const Napi::CallbackInfo& info) {
+    if(!_storage) return info.Env().Undefined();
+    return _storage->Flush(info.Env());
 }
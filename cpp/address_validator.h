@@ -2,15 +2,30 @@
 #define INCLUDE_CPP_LIBADDRESSINPUT_TS_H_
 
 
+#include <functional>
+#include <memory>
 #include <optional>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <napi.h>
 
 #include <libaddressinput/source.h>
+#include <libaddressinput/address_normalizer.h>
 #include <libaddressinput/address_validator.h>
 #include <libaddressinput/ondemand_supplier.h>
+#include <libaddressinput/region_data_builder.h>
 #include <libaddressinput/storage.h>
+#include <libaddressinput/supplier.h>
+
+#include "access_profile.h"
+#include "pending_gets.h"
+#include "postal_code_index.h"
+#include "suggestion_index.h"
+#include "worker_pool.h"
+#include "write_behind_buffer.h"
 
 #define STR(v) _STR(v)
 #define _STR(v) #v
@@ -21,6 +36,8 @@ Napi::Error unexpected_type_exception(Napi::Env env, std::string propName, std::
 Napi::Error unexpected_type_exception(Napi::Env env, std::string propName, std::string expected, std::string recieved) noexcept;
 Napi::Error unexpected_type_exception(Napi::Env env, std::string message) noexcept;
 
+void assert_typeof(Napi::Env env, std::string name, Napi::Value val, napi_valuetype type);
+
 
 class missing_callback : public std::exception {
 public:
@@ -41,10 +58,16 @@ public:
 
     void SetAcquisition(Napi::Function cb);
 
+    //Gets waiting on a promise returned by the callback
+    PendingGets& Pending() const;
+
 private:
     std::optional<Napi::FunctionReference> _get;
+    mutable PendingGets _pending;
 };
 
+//Storage calling back into JS. Without an acquisition callback every Get
+//finds nothing, and without a store every Put is dropped, like NullStorage.
 class JsDelegatedStorage : public Storage {
 public:
     void Get(const std::string& key, const Callback& data_ready) const override;
@@ -53,29 +76,202 @@ public:
     void SetAcquisition(Napi::Function cb);
     void SetStore(Napi::Function cb);
 
+    //Buffers puts and hands them to cb as one array of [key, data] entries
+    //once max_entries are waiting or max_delay_ms after the first of them
+    void SetBatchedStore(Napi::Function cb, size_t max_entries, double max_delay_ms);
+
+    //Writes buffered puts now. Returns what the batch callback returned, or
+    //undefined if nothing was waiting.
+    Napi::Value Flush(Napi::Env env);
+
+    PendingGets& Pending() const;
+
 private:
+    void WriteBatch(WriteBehindBuffer::Entries&& entries);
+
     std::optional<Napi::FunctionReference> _put;
     std::optional<Napi::FunctionReference> _get;
+    mutable PendingGets _pending;
+
+    std::optional<Napi::FunctionReference> _put_many;
+    std::shared_ptr<WriteBehindBuffer> _buffer;
+    double _max_delay_ms = 0;
+
+    //Set while Flush is writing, so it can return the callback's result
+    Napi::Value *_flushed = nullptr;
 };
 
+//Supplier that hands out a rule hierarchy which was already loaded by the real
+//supplier on the main thread. Lets AddressValidator run on a worker thread
+//without ever reaching back into a Source or Storage.
+class SnapshotSupplier : public Supplier {
+public:
+    SnapshotSupplier();
+
+    void Supply(const LookupKey& lookup_key, const Callback& supplied) override;
+    void SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) override;
+    size_t GetLoadedRuleDepth(const std::string& region_code) const override;
+
+    //pins keeps rules that could be evicted from a budgeted cache alive
+    void Capture(
+            bool success,
+            const RuleHierarchy& hierarchy,
+            size_t loaded_depth,
+            std::vector<std::shared_ptr<const Rule>> pins);
+
+private:
+    bool _success;
+    RuleHierarchy _hierarchy;
+    size_t _loaded_depth;
+    std::vector<std::shared_ptr<const Rule>> _pins;
+};
+
+class FileStorage;
+class PreloadingSupplier;
+class ResilientSource;
+class ResultCache;
+class RuleCache;
+class SingleFlight;
+class ValidatorMetrics;
+
 }
 }
 
+class PendingCall;
+class Prefetch;
+class ThreadedValidation;
+
+//How validateMany style calls report their results
+enum class ResultFormat {
+    //[AddressData, FieldProblemMap] tuples
+    TUPLES,
+
+    //A Uint32Array holding each address's problem mask, see problem_mask.h
+    PROBLEM_MASK
+};
+
+//Deadline and cancellation of a single validate call
+struct CallLimits {
+    //0 for none
+    double timeout_ms = 0;
+
+    //An AbortSignal, or undefined
+    Napi::Value signal;
+};
+
+//Builds the value a batch validation resolves with once every address is done.
+//succeeded has one flag per address, and only a partial batch can resolve with
+//some of them unset.
+using BatchMarshaller = std::function<Napi::Value (
+        Napi::Env env,
+        const std::vector<i18n::addressinput::AddressData>& addresses,
+        const std::vector<i18n::addressinput::FieldProblemMap>& problems,
+        const std::vector<char>& succeeded)>;
+
 class JsAddressValidator : public Napi::ObjectWrap<JsAddressValidator> {
 public:
     JsAddressValidator(const Napi::CallbackInfo& info);
+    ~JsAddressValidator();
     static Napi::Object Init(Napi::Env, Napi::Object exports);
 
     Napi::Value validate_address(const Napi::CallbackInfo& info);
+    Napi::Value validate_many(const Napi::CallbackInfo& info);
+    Napi::Value validate_many_compact(const Napi::CallbackInfo& info);
+    Napi::Value validate_parsed(const Napi::CallbackInfo& info);
+    Napi::Value validate_columns(const Napi::CallbackInfo& info);
     Napi::Value format_address(const Napi::CallbackInfo& info);
+    Napi::Value format_many(const Napi::CallbackInfo& info);
+    Napi::Value normalize(const Napi::CallbackInfo& info);
+    Napi::Value normalize_many(const Napi::CallbackInfo& info);
+    Napi::Value get_region_tree(const Napi::CallbackInfo& info);
+    Napi::Value suggest(const Napi::CallbackInfo& info);
+    Napi::Value infer_region(const Napi::CallbackInfo& info);
+    Napi::Value preload(const Napi::CallbackInfo& info);
+    Napi::Value preload_all(const Napi::CallbackInfo& info);
+    Napi::Value is_loaded(const Napi::CallbackInfo& info);
+    Napi::Value export_profile(const Napi::CallbackInfo& info);
+    Napi::Value prefetch(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+    Napi::Value reset_stats(const Napi::CallbackInfo& info);
+    Napi::Value flush(const Napi::CallbackInfo& info);
 
 private:
-    static Napi::FunctionReference constructor;
-    
+    friend class PendingCall;
+    friend class Prefetch;
+    friend class ThreadedValidation;
+
+    void begin_threaded(Napi::Env env);
+    void end_threaded(Napi::Env env);
+    void begin_waiting();
+    void end_waiting(bool cancelled);
+    i18n::addressinput::PreloadingSupplier& preloading(Napi::Env env);
+    Napi::Value validate_batch(const Napi::CallbackInfo& info, ResultFormat format);
+    Napi::Value region_tree(Napi::Env env, const std::string& region_code, const std::string& language);
+    Napi::Value suggestions(
+            Napi::Env env,
+            const i18n::addressinput::AddressData& address,
+            i18n::addressinput::AddressField field,
+            size_t limit);
+    Napi::Value normalize_batch(
+            Napi::Env env,
+            std::vector<i18n::addressinput::AddressData>&& addresses,
+            bool single);
+    Napi::Value run_batch(
+            Napi::Env env,
+            std::vector<i18n::addressinput::AddressData>&& addresses,
+            bool allow_postal,
+            bool require_name,
+            const i18n::addressinput::FieldProblemMap& filter,
+            const CallLimits& limits,
+            bool partial,
+            BatchMarshaller marshal);
+
     i18n::addressinput::JsDelegatedSource *_source;
     i18n::addressinput::JsDelegatedStorage *_storage;
-    i18n::addressinput::OndemandSupplier _supplier;
-    i18n::addressinput::AddressValidator _validator;
+    i18n::addressinput::FileStorage *_file_storage;
+    std::unique_ptr<i18n::addressinput::Supplier> _supplier;
+
+    //Validations look rules up through _profiling, which counts them into
+    //_profile. Prefetches go to _supplier directly so they don't count.
+    i18n::addressinput::AccessProfile _profile;
+    std::unique_ptr<i18n::addressinput::ProfilingSupplier> _profiling;
+    std::unique_ptr<i18n::addressinput::AddressValidator> _validator;
+    i18n::addressinput::PreloadingSupplier *_preload;
+    std::unique_ptr<i18n::addressinput::AddressNormalizer> _normalizer;
+    std::unique_ptr<i18n::addressinput::RegionDataBuilder> _region_builder;
+
+    //Frozen JS region trees by region code and requested language
+    std::unordered_map<std::string, Napi::ObjectReference> _region_trees;
+
+    //Indexes of a sub region list's names, by region, language and parent keys
+    std::unordered_map<std::string, i18n::addressinput::SuggestionIndex> _suggestion_indexes;
+
+    //Zip prefix sets of each loaded region, by region code
+    std::unordered_map<std::string, std::unique_ptr<i18n::addressinput::PostalCodeIndex>> _postal_indexes;
+
+    i18n::addressinput::ResilientSource *_resilience;
+    i18n::addressinput::SingleFlight *_source_flights;
+    i18n::addressinput::SingleFlight *_storage_flights;
+    std::shared_ptr<i18n::addressinput::ResultCache> _results;
+
+    //Null unless rules are cached by a CachingSupplier
+    std::shared_ptr<i18n::addressinput::RuleCache> _rule_cache;
+    std::shared_ptr<i18n::addressinput::ValidatorMetrics> _metrics;
+
+    bool _threaded;
+    size_t _inflight;
+
+    //Calls whose promise is still waiting on native work, and whether one was
+    //cancelled since the count was last 0
+    size_t _waiting;
+    bool _cancelled;
+
+    //When each validate call still waiting gives up, max() for never
+    std::multiset<i18n::addressinput::PendingGets::Clock::time_point> _call_deadlines;
+    Napi::ThreadSafeFunction _completions;
+
+    //Chunks of this validator's threaded validations still on the pool
+    std::shared_ptr<JobCounter> _jobs;
 };
 
 
@@ -0,0 +1,147 @@
+#include "caching_supplier.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "lookup_key.h"
+#include "region_data_constants.h"
+#include "retriever.h"
+#include "rule.h"
+
+namespace {
+
+//Set while a task's hierarchy is being handed to its callback
+thread_local const std::vector<std::shared_ptr<const i18n::addressinput::Rule>> *held_rules = nullptr;
+
+}
+
+//Loads every missing key of one lookup key's hierarchy, then reports the
+//hierarchy and deletes itself. Mirrors libaddressinput's OndemandSupplyTask.
+class i18n::addressinput::CachingSupplier::Task : public Retriever::Callback {
+public:
+    Task(const LookupKey& lookup_key, RuleCache& cache, const Supplier::Callback& supplied)
+        : _lookup_key(lookup_key), _cache(cache), _supplied(supplied), _success(true) { }
+
+    //The rules are held until the callback returns, so evicting them from the
+    //cache meanwhile can't free them
+    void Hold(size_t depth, std::shared_ptr<const Rule> rule) {
+        _hierarchy.rule[depth] = rule.get();
+        _held.push_back(std::move(rule));
+    }
+
+    void Queue(const std::string& key) {
+        _pending.insert(key);
+    }
+
+    //The final Retrieve call may complete and delete this task, so the loop
+    //condition must not touch any members once it has been issued.
+    void Retrieve(const Retriever& retriever) {
+        if(_pending.empty()) {
+            Loaded();
+            return;
+        }
+
+        bool done = false;
+        for(auto it = _pending.begin(); !done;) {
+            const std::string& key = *it++;
+            done = it == _pending.end();
+            retriever.Retrieve(key, *this);
+        }
+    }
+
+    void operator()(bool success, const std::string& key, const std::string& data) const override {
+        const_cast<Task*>(this)->Load(success, key, data);
+    }
+
+private:
+    void Load(bool success, const std::string& key, const std::string& data) {
+        size_t depth = std::count(key.begin(), key.end(), '/') - 1;
+        _pending.erase(key);
+
+        if(success) {
+            //The data server answers "{}" for keys it has no data for
+            if(data != "{}") {
+                auto rule = std::make_shared<Rule>();
+                if(depth == 0) {
+                    rule->CopyFrom(Rule::GetDefault());
+                }
+
+                if(rule->ParseSerializedRule(data)) {
+                    size_t bytes = RuleCache::EstimateBytes(*rule, data.size());
+                    Hold(depth, _cache.Insert(rule->GetId(), rule, bytes));
+                } else {
+                    _success = false;
+                }
+            }
+        } else {
+            _success = false;
+        }
+
+        if(_pending.empty()) {
+            Loaded();
+        }
+    }
+
+    void Loaded() {
+        auto outer = held_rules;
+        held_rules = &_held;
+        try {
+            _supplied(_success, _lookup_key, _hierarchy);
+        } catch(...) {
+            held_rules = outer;
+            throw;
+        }
+        held_rules = outer;
+        delete this;
+    }
+
+    const LookupKey& _lookup_key;
+    RuleCache& _cache;
+    const Supplier::Callback& _supplied;
+    Supplier::RuleHierarchy _hierarchy;
+    std::vector<std::shared_ptr<const Rule>> _held;
+    std::set<std::string> _pending;
+    bool _success;
+};
+
+i18n::addressinput::CachingSupplier::CachingSupplier(
+        const Source* source,
+        Storage* storage,
+        std::shared_ptr<RuleCache> cache)
+    : _retriever(new Retriever(source, storage))
+    , _cache(std::move(cache)) { }
+
+i18n::addressinput::CachingSupplier::~CachingSupplier() = default;
+
+void i18n::addressinput::CachingSupplier::Supply(const LookupKey& lookup_key, const Callback& supplied) {
+    Task *task = new Task(lookup_key, *_cache, supplied);
+
+    const std::string& region_code = lookup_key.GetRegionCode();
+    if(RegionDataConstants::IsSupported(region_code)) {
+        size_t max_depth = std::min(
+                lookup_key.GetDepth(),
+                RegionDataConstants::GetMaxLookupKeyDepth(region_code));
+
+        for(size_t depth = 0; depth <= max_depth; depth++) {
+            const std::string key = lookup_key.ToKeyString(depth);
+            auto rule = _cache->Get(key);
+            if(rule) {
+                task->Hold(depth, std::move(rule));
+            } else {
+                task->Queue(key);
+            }
+        }
+    }
+
+    task->Retrieve(*_retriever);
+}
+
+void i18n::addressinput::CachingSupplier::SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) {
+    Supply(lookup_key, supplied);
+}
+
+std::vector<std::shared_ptr<const i18n::addressinput::Rule>> i18n::addressinput::CachingSupplier::HeldRules() {
+    return held_rules != nullptr ? *held_rules : std::vector<std::shared_ptr<const Rule>>();
+}
@@ -0,0 +1,49 @@
+#ifndef INCLUDE_CPP_CACHING_SUPPLIER_H_
+#define INCLUDE_CPP_CACHING_SUPPLIER_H_
+
+#include <memory>
+#include <vector>
+
+#include <libaddressinput/source.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/supplier.h>
+
+#include "rule_cache.h"
+
+namespace i18n {
+namespace addressinput {
+
+class Retriever;
+class Rule;
+
+//Equivalent of OndemandSupplier which keeps its parsed rules in a RuleCache
+//that can be shared between validators. Only keys missing from the cache are
+//retrieved through this supplier's own Source and Storage.
+class CachingSupplier : public Supplier {
+public:
+    //Takes ownership of source and storage
+    CachingSupplier(const Source* source, Storage* storage, std::shared_ptr<RuleCache> cache);
+    ~CachingSupplier() override;
+
+    CachingSupplier(const CachingSupplier&) = delete;
+    CachingSupplier& operator=(const CachingSupplier&) = delete;
+
+    void Supply(const LookupKey& lookup_key, const Callback& supplied) override;
+    void SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) override;
+
+    //The rules being handed to a supplied callback on this thread, empty
+    //outside of one. A callback that keeps using them after it returns, e.g.
+    //on a worker thread, holds on to these so eviction can't free them.
+    static std::vector<std::shared_ptr<const Rule>> HeldRules();
+
+private:
+    class Task;
+
+    const std::unique_ptr<const Retriever> _retriever;
+    std::shared_ptr<RuleCache> _cache;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_CACHING_SUPPLIER_H_
@@ -0,0 +1,211 @@
+#include "file_storage.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//Starts every record. JSON escapes control characters, so the data can't
+//contain it.
+constexpr char kRecordMarker = '\x1e';
+
+//FNV-1a over the key and the data
+uint32_t checksum(const char *key, size_t key_size, const char *data, size_t data_size) {
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](const char *bytes, size_t size) {
+        for(size_t i = 0; i < size; i++) {
+            hash ^= static_cast<unsigned char>(bytes[i]);
+            hash *= 16777619u;
+        }
+    };
+    add(key, key_size);
+    hash ^= '\t';
+    hash *= 16777619u;
+    add(data, data_size);
+    return hash;
+}
+
+}
+
+i18n::addressinput::FileStorage* i18n::addressinput::FileStorage::Open(const std::string& path, std::string* error) {
+    int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        *error = "Unable to open storage file " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+
+    FileStorage *storage = new FileStorage(fd);
+    storage->Refresh();
+    return storage;
+}
+
+i18n::addressinput::FileStorage::FileStorage(int fd)
+    : _fd(fd), _map(nullptr), _mapped(0), _scanned(0), _write_errors(0) { }
+
+i18n::addressinput::FileStorage::~FileStorage() {
+    Remap(0);
+    ::close(_fd);
+}
+
+void i18n::addressinput::FileStorage::Put(const std::string& key, std::string* data) {
+    std::unique_ptr<std::string> owned(data);
+
+    if(key.find(kRecordMarker) != std::string::npos || data->find(kRecordMarker) != std::string::npos) {
+        _write_errors++;
+        _last_write_error = "Unable to store " + key + ": data contains a record separator";
+        return;
+    }
+
+    std::string record(1, kRecordMarker);
+    record.append(key);
+    record.push_back('\t');
+    record.append(std::to_string(data->size()));
+    record.push_back('\t');
+    record.append(std::to_string(checksum(key.data(), key.size(), data->data(), data->size())));
+    record.push_back('\n');
+    record.append(*data);
+    record.push_back('\n');
+
+    //A single write keeps the record contiguous under O_APPEND even when
+    //several processes share the file. If it fails part way, the torn record
+    //is skipped when indexing.
+    size_t written = 0;
+    while(written < record.size()) {
+        ssize_t n = ::write(_fd, record.data() + written, record.size() - written);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            _write_errors++;
+            _last_write_error = "Unable to write " + key + " to storage: " + std::strerror(errno);
+            return;
+        }
+        written += n;
+    }
+
+    off_t end = ::lseek(_fd, 0, SEEK_CUR);
+    if(end < 0) {
+        _write_errors++;
+        _last_write_error = "Unable to locate " + key + " in storage: " + std::strerror(errno);
+        return;
+    }
+
+    _index[key] = {static_cast<size_t>(end) - 1 - data->size(), data->size()};
+}
+
+void i18n::addressinput::FileStorage::Get(const std::string& key, const Callback& data_ready) const {
+    auto it = _index.find(key);
+    if(it == _index.end() || it->second.first + it->second.second > _mapped) {
+        Refresh();
+        it = _index.find(key);
+    }
+
+    if(it == _index.end() || it->second.first + it->second.second > _mapped) {
+        data_ready(false, key, nullptr);
+        return;
+    }
+
+    data_ready(true, key, new std::string(_map + it->second.first, it->second.second));
+}
+
+void i18n::addressinput::FileStorage::Refresh() const {
+    struct stat st;
+    if(::fstat(_fd, &st) != 0) return;
+
+    if(static_cast<size_t>(st.st_size) > _mapped) {
+        Remap(st.st_size);
+        Scan();
+    }
+}
+
+void i18n::addressinput::FileStorage::Remap(size_t size) const {
+    if(_map != nullptr) {
+        ::munmap(const_cast<char*>(_map), _mapped);
+        _map = nullptr;
+        _mapped = 0;
+    }
+
+    if(size == 0) return;
+
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, 0);
+    if(map == MAP_FAILED) return;
+
+    _map = static_cast<const char*>(map);
+    _mapped = size;
+}
+
+void i18n::addressinput::FileStorage::Scan() const {
+    while(_scanned < _mapped) {
+        const char *begin = _map + _scanned;
+        const char *end = _map + _mapped;
+
+        //Left over from a torn record, nothing to index until the next one
+        if(*begin != kRecordMarker) {
+            const char *next = static_cast<const char*>(std::memchr(begin, kRecordMarker, end - begin));
+            _scanned = next == nullptr ? _mapped : next - _map;
+            continue;
+        }
+
+        //A header without its newline is either still being written, or
+        //torn if another record already follows it
+        const char *newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        const char *header_end = newline == nullptr ? end : newline;
+        const char *next = static_cast<const char*>(std::memchr(begin + 1, kRecordMarker, header_end - begin - 1));
+        if(next != nullptr) {
+            _scanned = next - _map;
+            continue;
+        }
+        if(newline == nullptr) return;
+
+        const char *tab = static_cast<const char*>(std::memchr(begin, '\t', newline - begin));
+        const char *length_end = tab == nullptr ? nullptr
+            : static_cast<const char*>(std::memchr(tab + 1, '\t', newline - tab - 1));
+        char *parsed = nullptr;
+        size_t length = length_end == nullptr ? 0 : std::strtoull(tab + 1, &parsed, 10);
+        uint32_t sum = 0;
+        if(parsed == length_end && length_end != nullptr) {
+            sum = std::strtoul(length_end + 1, &parsed, 10);
+        }
+        if(length_end == nullptr || parsed != newline) {
+            _scanned = newline + 1 - _map;
+            continue;
+        }
+
+        //Data never contains a marker, so one inside the record means the
+        //record was cut short and another written after it
+        size_t offset = newline + 1 - _map;
+        size_t available = std::min(length + 1, _mapped - offset);
+        next = static_cast<const char*>(std::memchr(_map + offset, kRecordMarker, available));
+        if(next != nullptr) {
+            _scanned = next - _map;
+            continue;
+        }
+
+        //Stop at a record that is still being written
+        if(offset + length + 1 > _mapped) return;
+
+        const char *key = begin + 1;
+        size_t key_size = tab - key;
+        if(_map[offset + length] != '\n' || checksum(key, key_size, _map + offset, length) != sum) {
+            _scanned = offset;
+            continue;
+        }
+
+        _index[std::string(key, key_size)] = {offset, length};
+        _scanned = offset + length + 1;
+    }
+}
+
+uint64_t i18n::addressinput::FileStorage::WriteErrors() const {
+    return _write_errors;
+}
+
+const std::string& i18n::addressinput::FileStorage::LastWriteError() const {
+    return _last_write_error;
+}
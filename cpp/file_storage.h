@@ -0,0 +1,60 @@
+#ifndef INCLUDE_CPP_FILE_STORAGE_H_
+#define INCLUDE_CPP_FILE_STORAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <libaddressinput/storage.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Storage persisted to a single append-only file of
+//"\x1e<key>\t<length>\t<checksum>\n<data>\n" records, where the last record
+//for a key wins. Reads are served from a read-only memory map of the file, so
+//cached lookups never leave native code and a restarted process only has to
+//index the file to be warm again.
+//
+//A write that fails part way, or a crash in the middle of one, leaves a torn
+//record behind. Records start with a byte JSON data can't contain and carry a
+//checksum, so indexing skips a torn one and resumes at the next record.
+class FileStorage : public Storage {
+public:
+    //Returns nullptr and fills error if the file can't be opened or created
+    static FileStorage* Open(const std::string& path, std::string* error);
+    ~FileStorage() override;
+
+    FileStorage(const FileStorage&) = delete;
+    FileStorage& operator=(const FileStorage&) = delete;
+
+    void Put(const std::string& key, std::string* data) override;
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+    //Puts that couldn't be written, and the reason the last one failed
+    uint64_t WriteErrors() const;
+    const std::string& LastWriteError() const;
+
+private:
+    explicit FileStorage(int fd);
+
+    //Maps any bytes appended since the last refresh, by this or another
+    //process, and indexes the complete records among them
+    void Refresh() const;
+    void Remap(size_t size) const;
+    void Scan() const;
+
+    int _fd;
+    mutable const char *_map;
+    mutable size_t _mapped;
+    mutable size_t _scanned;
+    mutable std::unordered_map<std::string, std::pair<size_t, size_t>> _index;
+    uint64_t _write_errors;
+    std::string _last_write_error;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_FILE_STORAGE_H_
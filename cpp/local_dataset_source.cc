@@ -0,0 +1,161 @@
+#include "local_dataset_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kDataKeyPrefix[] = "data/";
+
+//Length of a region's aggregate key, e.g. "data/CH"
+constexpr size_t kAggregateKeyLength = sizeof kDataKeyPrefix - 1 + 2;
+
+bool list_files(const std::string& path, std::vector<std::string>* files, std::string* error) {
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0) {
+        *error = "Unable to open dataset " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    if(!S_ISDIR(st.st_mode)) {
+        if(S_ISREG(st.st_mode)) files->push_back(path);
+        return true;
+    }
+
+    DIR *dir = ::opendir(path.c_str());
+    if(dir == nullptr) {
+        *error = "Unable to open dataset directory " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::vector<std::string> entries;
+    while(struct dirent *entry = ::readdir(dir)) {
+        if(entry->d_name[0] == '.') continue;
+        entries.push_back(path + '/' + entry->d_name);
+    }
+    ::closedir(dir);
+
+    std::sort(entries.begin(), entries.end());
+    for(const auto& entry : entries) {
+        if(!list_files(entry, files, error)) return false;
+    }
+    return true;
+}
+
+}
+
+i18n::addressinput::LocalDatasetSource* i18n::addressinput::LocalDatasetSource::Open(
+        const std::string& path, bool aggregate, std::string* error) {
+    std::vector<std::string> files;
+    if(!list_files(path, &files, error)) return nullptr;
+
+    //Owned by the source once it exists, unmapped here on the way out otherwise
+    std::vector<Mapping> maps;
+    auto unmap = [&]() {
+        for(const auto& map : maps) ::munmap(const_cast<char*>(map.data), map.size);
+    };
+
+    for(const auto& file : files) {
+        int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if(fd < 0 || ::fstat(fd, &st) != 0) {
+            *error = "Unable to open dataset file " + file + ": " + std::strerror(errno);
+            if(fd >= 0) ::close(fd);
+            unmap();
+            return nullptr;
+        }
+
+        if(st.st_size == 0) {
+            ::close(fd);
+            continue;
+        }
+
+        void *map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int mmap_errno = errno;
+        ::close(fd);
+        if(map == MAP_FAILED) {
+            *error = "Unable to map dataset file " + file + ": " + std::strerror(mmap_errno);
+            unmap();
+            return nullptr;
+        }
+        maps.push_back(Mapping{static_cast<const char*>(map), static_cast<size_t>(st.st_size)});
+    }
+
+    return new LocalDatasetSource(std::move(maps), aggregate);
+}
+
+i18n::addressinput::LocalDatasetSource::LocalDatasetSource(std::vector<Mapping> maps, bool aggregate)
+    : _maps(std::move(maps)), _aggregate(aggregate), _indexed(false) { }
+
+i18n::addressinput::LocalDatasetSource::~LocalDatasetSource() {
+    for(const auto& map : _maps) {
+        ::munmap(const_cast<char*>(map.data), map.size);
+    }
+}
+
+void i18n::addressinput::LocalDatasetSource::Get(const std::string& key, const Callback& data_ready) const {
+    if(!_indexed) Index();
+
+    auto by_key = [](const std::pair<std::string_view, std::string_view>& entry, std::string_view key) {
+        return entry.first < key;
+    };
+    auto it = std::lower_bound(_index.begin(), _index.end(), std::string_view(key), by_key);
+
+    bool region = key.size() == kAggregateKeyLength && key.compare(0, sizeof kDataKeyPrefix - 1, kDataKeyPrefix) == 0;
+    if(!_aggregate || !region) {
+        bool found = it != _index.end() && it->first == key;
+        data_ready(true, key, found ? new std::string(it->second) : new std::string("{}"));
+        return;
+    }
+
+    //The region itself, its language variants, e.g. "data/CH--fr", and
+    //everything under it, e.g. "data/CH/AG"
+    std::unique_ptr<std::string> data(new std::string("{"));
+    for(; it != _index.end() && it->first.compare(0, key.size(), key) == 0; ++it) {
+        if(it->first.size() > key.size() && it->first[key.size()] != '/' && it->first[key.size()] != '-') continue;
+
+        if(data->size() > 1) data->append(", ");
+        data->push_back('"');
+        data->append(it->first);
+        data->append("\": ");
+        data->append(it->second);
+    }
+    data->push_back('}');
+
+    data_ready(true, key, data.release());
+}
+
+void i18n::addressinput::LocalDatasetSource::Index() const {
+    for(const auto& map : _maps) {
+        const char *begin = map.data;
+        const char *end = map.data + map.size;
+
+        while(begin < end) {
+            const char *newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            const char *line_end = newline != nullptr ? newline : end;
+            const char *value_end = line_end > begin && line_end[-1] == '\r' ? line_end - 1 : line_end;
+
+            const char *equals = static_cast<const char*>(std::memchr(begin, '=', value_end - begin));
+            if(equals != nullptr && equals != begin) {
+                _index.emplace_back(std::string_view(begin, equals - begin),
+                        std::string_view(equals + 1, value_end - equals - 1));
+            }
+            begin = line_end + 1;
+        }
+    }
+
+    //Stable so that, of several lines with the same key, the last one read is
+    //last among its equals and the one kept
+    std::stable_sort(_index.begin(), _index.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    auto last = std::unique(_index.rbegin(), _index.rend(), [](const auto& a, const auto& b) { return a.first == b.first; });
+    _index.erase(_index.begin(), last.base());
+    _indexed = true;
+}
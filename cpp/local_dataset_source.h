@@ -0,0 +1,56 @@
+#ifndef INCLUDE_CPP_LOCAL_DATASET_SOURCE_H_
+#define INCLUDE_CPP_LOCAL_DATASET_SOURCE_H_
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <libaddressinput/source.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Source serving region data from local files of "<key>=<data>" lines, the
+//format of libaddressinput's testdata/countryinfo.txt. The files are memory
+//mapped when opened and indexed on the first lookup, after which every Get is
+//answered from the maps without leaving native code.
+class LocalDatasetSource : public Source {
+public:
+    //path is either a single dataset file or a directory, all of whose files
+    //at any depth are read as one dataset. Where several lines have the same
+    //key the last one wins, taking files in path order. With aggregate set,
+    //region keys such as "data/CH" are answered with the data of every key of
+    //that region, as PreloadSupplier expects. Returns nullptr and fills error
+    //if anything can't be opened.
+    static LocalDatasetSource* Open(const std::string& path, bool aggregate, std::string* error);
+    ~LocalDatasetSource() override;
+
+    LocalDatasetSource(const LocalDatasetSource&) = delete;
+    LocalDatasetSource& operator=(const LocalDatasetSource&) = delete;
+
+    //Keys missing from the dataset get "{}", like the chromium-i18n service
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+private:
+    struct Mapping {
+        const char *data;
+        size_t size;
+    };
+
+    LocalDatasetSource(std::vector<Mapping> maps, bool aggregate);
+
+    void Index() const;
+
+    std::vector<Mapping> _maps;
+    bool _aggregate;
+    mutable bool _indexed;
+
+    //Sorted by key, pointing into _maps
+    mutable std::vector<std::pair<std::string_view, std::string_view>> _index;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_LOCAL_DATASET_SOURCE_H_
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <ctime>
+
+#include "metrics.h"
+#include "validating_util.h"
+
+const uint64_t i18n::addressinput::kLatencyBoundsUs[kLatencyBounds] = {
+    50, 100, 250, 500,
+    1000, 2500, 5000, 10000,
+    25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 10000000
+};
+
+namespace {
+
+//"data/US/CA" and "data/US--fr" both belong to US
+std::string region_of(const std::string& rule_key) {
+    size_t begin = rule_key.find('/');
+    if(begin == std::string::npos) return rule_key;
+    begin++;
+
+    size_t end = rule_key.find_first_of("/-", begin);
+    return rule_key.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+//Whether stored data, as wrapped by ValidatingStorage, hasn't expired yet.
+//Only the timestamp, its first line, is copied.
+bool fresh(const std::string& data) {
+    size_t header = data.find('\n');
+    std::string timestamp(data, 0, header == std::string::npos ? header : header + 1);
+    return i18n::addressinput::ValidatingUtil::UnwrapTimestamp(&timestamp, std::time(nullptr));
+}
+
+class Timed : public i18n::addressinput::Source::Callback {
+public:
+    Timed(
+        std::shared_ptr<i18n::addressinput::ValidatorMetrics> metrics,
+        bool storage,
+        const i18n::addressinput::Source::Callback& data_ready)
+        : _metrics(metrics)
+        , _storage(storage)
+        , _start(i18n::addressinput::LatencyHistogram::Clock::now())
+        , _data_ready(data_ready) { }
+
+    void operator()(bool success, const std::string& key, std::string *data) const override {
+        if(_storage) {
+            _metrics->storage_wait.Since(_start);
+
+            //An expired copy is fetched from the source next, which counts
+            //the miss
+            if(success && data != nullptr && fresh(*data)) _metrics->RuleLookup(key, true);
+        } else {
+            _metrics->source_wait.Since(_start);
+        }
+        _data_ready(success, key, data);
+        delete this;
+    }
+
+private:
+    std::shared_ptr<i18n::addressinput::ValidatorMetrics> _metrics;
+    bool _storage;
+    i18n::addressinput::LatencyHistogram::Clock::time_point _start;
+    const i18n::addressinput::Source::Callback& _data_ready;
+};
+
+}
+
+i18n::addressinput::LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+void i18n::addressinput::LatencyHistogram::Record(Clock::duration elapsed) {
+    uint64_t us = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+    size_t bucket = 0;
+    while(bucket < kLatencyBounds && us > kLatencyBoundsUs[bucket]) bucket++;
+
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+void i18n::addressinput::LatencyHistogram::Since(Clock::time_point start) {
+    Record(Clock::now() - start);
+}
+
+void i18n::addressinput::LatencyHistogram::Reset() {
+    for(auto& bucket : _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _sum_us.store(0, std::memory_order_relaxed);
+}
+
+uint64_t i18n::addressinput::LatencyHistogram::Count() const {
+    return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t i18n::addressinput::LatencyHistogram::SumUs() const {
+    return _sum_us.load(std::memory_order_relaxed);
+}
+
+uint64_t i18n::addressinput::LatencyHistogram::Bucket(size_t index) const {
+    return _buckets[index].load(std::memory_order_relaxed);
+}
+
+i18n::addressinput::ValidatorMetrics::ValidatorMetrics()
+    : validations(0)
+    , inflight(0)
+    , source_gets(0)
+    , storage_gets(0)
+    , storage_puts(0) { }
+
+i18n::addressinput::ValidatorMetrics::Clock::time_point i18n::addressinput::ValidatorMetrics::Begin() {
+    validations.fetch_add(1, std::memory_order_relaxed);
+    inflight.fetch_add(1, std::memory_order_relaxed);
+    return Clock::now();
+}
+
+void i18n::addressinput::ValidatorMetrics::End(Clock::time_point start) {
+    validate.Since(start);
+    inflight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void i18n::addressinput::ValidatorMetrics::RuleLookup(const std::string& rule_key, bool hit) {
+    auto& region = _regions[region_of(rule_key)];
+    if(hit) {
+        region.rule_hits++;
+    } else {
+        region.rule_misses++;
+    }
+}
+
+void i18n::addressinput::ValidatorMetrics::ResultLookup(const std::string& region_code, bool hit) {
+    auto& region = _regions[region_code];
+    if(hit) {
+        region.result_hits++;
+    } else {
+        region.result_misses++;
+    }
+}
+
+const std::map<std::string, i18n::addressinput::RegionCounters>& i18n::addressinput::ValidatorMetrics::Regions() const {
+    return _regions;
+}
+
+void i18n::addressinput::ValidatorMetrics::Reset() {
+    validate.Reset();
+    marshal.Reset();
+    source_wait.Reset();
+    storage_wait.Reset();
+    validations.store(0, std::memory_order_relaxed);
+    source_gets.store(0, std::memory_order_relaxed);
+    storage_gets.store(0, std::memory_order_relaxed);
+    storage_puts.store(0, std::memory_order_relaxed);
+    _regions.clear();
+}
+
+i18n::addressinput::TimedSource::TimedSource(const Source* source, std::shared_ptr<ValidatorMetrics> metrics)
+    : _source(source), _metrics(metrics) { }
+
+void i18n::addressinput::TimedSource::Get(const std::string& key, const Callback& data_ready) const {
+    _metrics->source_gets.fetch_add(1, std::memory_order_relaxed);
+    _metrics->RuleLookup(key, false);
+    _source->Get(key, *new Timed(_metrics, false, data_ready));
+}
+
+i18n::addressinput::TimedStorage::TimedStorage(Storage* storage, std::shared_ptr<ValidatorMetrics> metrics)
+    : _storage(storage), _metrics(metrics) { }
+
+void i18n::addressinput::TimedStorage::Put(const std::string& key, std::string* data) {
+    _metrics->storage_puts.fetch_add(1, std::memory_order_relaxed);
+    _storage->Put(key, data);
+}
+
+void i18n::addressinput::TimedStorage::Get(const std::string& key, const Callback& data_ready) const {
+    _metrics->storage_gets.fetch_add(1, std::memory_order_relaxed);
+    _storage->Get(key, *new Timed(_metrics, true, data_ready));
+}
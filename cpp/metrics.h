@@ -0,0 +1,131 @@
+#ifndef INCLUDE_CPP_METRICS_H_
+#define INCLUDE_CPP_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <libaddressinput/source.h>
+#include <libaddressinput/storage.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Upper bounds of the latency buckets in microseconds, in the spirit of the
+//Prometheus defaults. Anything slower lands in a final overflow bucket.
+constexpr size_t kLatencyBounds = 16;
+extern const uint64_t kLatencyBoundsUs[kLatencyBounds];
+
+//Fixed bucket latency histogram. Recording is lock free, so it is safe from
+//any thread.
+class LatencyHistogram {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(Clock::duration elapsed);
+    void Since(Clock::time_point start);
+    void Reset();
+
+    uint64_t Count() const;
+    uint64_t SumUs() const;
+
+    //Observations in bucket index alone, kLatencyBounds being the overflow
+    uint64_t Bucket(size_t index) const;
+
+private:
+    std::atomic<uint64_t> _buckets[kLatencyBounds + 1];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum_us;
+};
+
+//Hit and miss counts for one region code
+struct RegionCounters {
+    //Rule lookups answered by a fresh copy in storage, and calls made to the
+    //source, including retries and background refreshes
+    uint64_t rule_hits = 0;
+    uint64_t rule_misses = 0;
+
+    uint64_t result_hits = 0;
+    uint64_t result_misses = 0;
+};
+
+//Counters and latencies of a single validator. The totals are atomics so that
+//reading them never blocks a validation. Per region counts are only updated
+//from the JS main thread, where every lookup they count happens.
+class ValidatorMetrics {
+public:
+    using Clock = LatencyHistogram::Clock;
+
+    ValidatorMetrics();
+
+    ValidatorMetrics(const ValidatorMetrics&) = delete;
+    ValidatorMetrics& operator=(const ValidatorMetrics&) = delete;
+
+    //Bracket a validate/validateMany call
+    Clock::time_point Begin();
+    void End(Clock::time_point start);
+
+    void RuleLookup(const std::string& rule_key, bool hit);
+    void ResultLookup(const std::string& region_code, bool hit);
+
+    const std::map<std::string, RegionCounters>& Regions() const;
+
+    //Zeroes everything but the in flight gauge, which tracks live calls
+    void Reset();
+
+    LatencyHistogram validate;
+    LatencyHistogram marshal;
+    LatencyHistogram source_wait;
+    LatencyHistogram storage_wait;
+
+    std::atomic<uint64_t> validations;
+    std::atomic<int64_t> inflight;
+    std::atomic<uint64_t> source_gets;
+    std::atomic<uint64_t> storage_gets;
+    std::atomic<uint64_t> storage_puts;
+
+private:
+    std::map<std::string, RegionCounters> _regions;
+};
+
+//Counts and times every Get of the wrapped source, each a rule cache miss for
+//the key's region
+class TimedSource : public Source {
+public:
+    //Takes ownership of source
+    TimedSource(const Source* source, std::shared_ptr<ValidatorMetrics> metrics);
+
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+private:
+    std::unique_ptr<const Source> _source;
+    std::shared_ptr<ValidatorMetrics> _metrics;
+};
+
+//Counts and times every Get and Put of the wrapped storage. A Get that finds
+//data which hasn't expired is a rule cache hit for the key's region.
+class TimedStorage : public Storage {
+public:
+    //Takes ownership of storage
+    TimedStorage(Storage* storage, std::shared_ptr<ValidatorMetrics> metrics);
+
+    void Put(const std::string& key, std::string* data) override;
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+private:
+    std::unique_ptr<Storage> _storage;
+    std::shared_ptr<ValidatorMetrics> _metrics;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_METRICS_H_
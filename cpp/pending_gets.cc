@@ -0,0 +1,80 @@
+#include <vector>
+
+#include "pending_gets.h"
+#include "timers.h"
+
+i18n::addressinput::PendingGets::Get::Get(
+        PendingGets *owner,
+        const std::string& key,
+        const Source::Callback& data_ready)
+    : _owner(owner), _key(key), _data_ready(&data_ready) { }
+
+void i18n::addressinput::PendingGets::Get::Settle(bool success, std::string *data) {
+    if(_data_ready == nullptr) {
+        delete data;
+        return;
+    }
+
+    const Source::Callback *data_ready = _data_ready;
+    _data_ready = nullptr;
+
+    if(!_timer.IsEmpty()) {
+        clear_timeout(_timer.Env(), _timer.Value());
+        _timer.Reset();
+    }
+
+    //Keeps this alive through the callback when only the registry held it
+    auto self = _owner->_pending[this];
+    _owner->_pending.erase(this);
+    (*data_ready)(success, _key, data);
+}
+
+//Whatever the remaining gets would answer is going away too, so late
+//promises must find them settled
+i18n::addressinput::PendingGets::~PendingGets() {
+    for(auto& item : _pending) {
+        item.second->_data_ready = nullptr;
+        item.second->_timer.Reset();
+    }
+}
+
+void i18n::addressinput::PendingGets::SetDeadline(Deadline deadline) {
+    _deadline = std::move(deadline);
+}
+
+std::shared_ptr<i18n::addressinput::PendingGets::Get> i18n::addressinput::PendingGets::Add(
+        Napi::Env env,
+        const std::string& key,
+        const Source::Callback& data_ready) {
+    auto get = std::make_shared<Get>(this, key, data_ready);
+    _pending[get.get()] = get;
+
+    //Failing a hung get fails every lookup that joined it too, so the key
+    //can be fetched afresh rather than each later lookup waiting on it
+    Clock::time_point deadline = _deadline ? _deadline() : Clock::time_point::max();
+    if(deadline != Clock::time_point::max()) {
+        double delay_ms = std::chrono::duration<double, std::milli>(deadline - Clock::now()).count();
+        std::weak_ptr<Get> weak = get;
+        get->_timer = Napi::Persistent(set_timeout(env, [weak]() {
+            if(auto hung = weak.lock()) hung->Settle(false, nullptr);
+        }, delay_ms > 0 ? delay_ms : 0, false));
+    }
+    return get;
+}
+
+void i18n::addressinput::PendingGets::Abandon() {
+    //Each Settle erases its get, and its callback may add new ones
+    std::vector<std::shared_ptr<Get>> abandoned;
+    abandoned.reserve(_pending.size());
+    for(auto& item : _pending) {
+        abandoned.push_back(item.second);
+    }
+
+    for(auto& get : abandoned) {
+        get->Settle(false, nullptr);
+    }
+}
+
+size_t i18n::addressinput::PendingGets::Size() const {
+    return _pending.size();
+}
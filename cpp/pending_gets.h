@@ -0,0 +1,73 @@
+#ifndef INCLUDE_CPP_PENDING_GETS_H_
+#define INCLUDE_CPP_PENDING_GETS_H_
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <napi.h>
+
+#include <libaddressinput/source.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Gets handed to a JS callback whose promise hasn't settled yet. Every one is
+//answered exactly once, by its promise, its deadline or Abandon, whichever
+//comes first, so a promise settling late is ignored. Only used from the JS
+//main thread.
+class PendingGets {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    //When a get added now should be failed, Clock::time_point::max() for never
+    using Deadline = std::function<Clock::time_point ()>;
+
+    class Get {
+    public:
+        Get(PendingGets *owner, const std::string& key, const Source::Callback& data_ready);
+
+        Get(const Get&) = delete;
+        Get& operator=(const Get&) = delete;
+
+        //Takes ownership of data
+        void Settle(bool success, std::string *data);
+
+    private:
+        friend class PendingGets;
+
+        PendingGets *_owner;
+        std::string _key;
+        const Source::Callback *_data_ready;
+        Napi::Reference<Napi::Value> _timer;
+    };
+
+    PendingGets() = default;
+    ~PendingGets();
+
+    PendingGets(const PendingGets&) = delete;
+    PendingGets& operator=(const PendingGets&) = delete;
+
+    void SetDeadline(Deadline deadline);
+
+    //The get is kept until it settles, even if the promise answering it is
+    //garbage collected first, so it can still be abandoned
+    std::shared_ptr<Get> Add(Napi::Env env, const std::string& key, const Source::Callback& data_ready);
+
+    //Fails every pending get now. Gets added while doing so, by callbacks
+    //reacting to the failures, are left alone.
+    void Abandon();
+
+    size_t Size() const;
+
+private:
+    std::unordered_map<Get*, std::shared_ptr<Get>> _pending;
+    Deadline _deadline;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_PENDING_GETS_H_
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cctype>
+
+#include "postal_code_index.h"
+
+namespace {
+
+RE2::Options matcher_options() {
+    RE2::Options options;
+    options.set_never_capture(true);
+    options.set_log_errors(false);
+    return options;
+}
+
+}
+
+i18n::addressinput::PostalCodeIndex::PostalCodeIndex(
+        const std::string& region_key,
+        const std::map<std::string, std::string>& patterns)
+    : _region_key(region_key) {
+    auto format = patterns.find(region_key);
+    if(format != patterns.end()) {
+        _format.reset(new RE2(format->second, matcher_options()));
+    }
+
+    std::string prefix = region_key + '/';
+    for(const auto& item : patterns) {
+        const std::string& key = item.first;
+        if(key.compare(0, prefix.size(), prefix) != 0 || key.find("--") != std::string::npos) continue;
+
+        std::unique_ptr<RE2> matcher(new RE2(item.second, matcher_options()));
+        if(!matcher->ok()) continue;
+
+        auto& level = _levels[key.substr(0, key.rfind('/'))];
+        level.keys.push_back(key);
+        level.matchers.push_back(std::move(matcher));
+    }
+
+    for(auto& item : _levels) {
+        auto& level = item.second;
+        level.set.reset(new RE2::Set(matcher_options(), RE2::UNANCHORED));
+
+        bool added = true;
+        for(const auto& matcher : level.matchers) {
+            added = level.set->Add(matcher->pattern(), nullptr) >= 0;
+            if(!added) break;
+        }
+        if(!added || !level.set->Compile()) {
+            level.set.reset();
+        }
+    }
+}
+
+std::vector<std::string> i18n::addressinput::PostalCodeIndex::Infer(const std::string& postal_code) const {
+    std::vector<std::string> ret;
+
+    std::string code = postal_code;
+    code.erase(0, code.find_first_not_of(" \t"));
+    code.erase(code.find_last_not_of(" \t") + 1);
+    std::transform(code.begin(), code.end(), code.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    if(code.empty() || (_format != nullptr && _format->ok() && !RE2::FullMatch(code, *_format))) {
+        return ret;
+    }
+
+    std::vector<int> matches;
+    std::string parent = _region_key;
+    for(;;) {
+        auto level = _levels.find(parent);
+        if(level == _levels.end()) break;
+
+        matches.clear();
+        if(level->second.set != nullptr) {
+            level->second.set->Match(code, &matches);
+        } else {
+            for(size_t i = 0; i < level->second.matchers.size() && matches.size() < 2; i++) {
+                if(RE2::PartialMatch(code, *level->second.matchers[i])) matches.push_back(i);
+            }
+        }
+        if(matches.size() != 1) break;
+
+        parent = level->second.keys[matches[0]];
+        ret.push_back(parent.substr(parent.rfind('/') + 1));
+    }
+    return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef INCLUDE_CPP_POSTAL_CODE_INDEX_H_
+#define INCLUDE_CPP_POSTAL_CODE_INDEX_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <re2/re2.h>
+#include <re2/set.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Infers which sub regions a postal code belongs to from the zip prefixes of a
+//region's rules. The prefixes of all the sub regions under one parent are
+//merged into a single RE2::Set, so each level is one pass over the postal code
+//rather than one regex per sub region.
+class PostalCodeIndex {
+public:
+    //patterns maps rule keys, e.g. "data/US" and "data/US/CA", to their zip
+    //patterns as Rule compiles them, anchored at the start. Keys of language
+    //variants, e.g. "data/CA/QC--fr", are skipped.
+    PostalCodeIndex(const std::string& region_key, const std::map<std::string, std::string>& patterns);
+
+    PostalCodeIndex(const PostalCodeIndex&) = delete;
+    PostalCodeIndex& operator=(const PostalCodeIndex&) = delete;
+
+    //Sub region keys from the admin area down, e.g. {"CA"}. Stops at the
+    //first level where no sub region or more than one matches, and is empty if
+    //the postal code doesn't match the region's own pattern.
+    std::vector<std::string> Infer(const std::string& postal_code) const;
+
+private:
+    struct Level {
+        //Null if the set couldn't be compiled, matchers are tried in turn then
+        std::unique_ptr<RE2::Set> set;
+        std::vector<std::unique_ptr<RE2>> matchers;
+        std::vector<std::string> keys;
+    };
+
+    std::string _region_key;
+    std::unique_ptr<RE2> _format;
+
+    //By parent rule key
+    std::unordered_map<std::string, Level> _levels;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_POSTAL_CODE_INDEX_H_
@@ -0,0 +1,85 @@
+#include "preloading_supplier.h"
+
+#include "lookup_key.h"
+#include "region_data_constants.h"
+
+i18n::addressinput::PreloadingSupplier::PreloadingSupplier(const Source* source, Storage* storage)
+    : _supplier(source, storage)
+    , _loaded(this) { }
+
+i18n::addressinput::PreloadingSupplier::~PreloadingSupplier() = default;
+
+void i18n::addressinput::PreloadingSupplier::Supply(const LookupKey& lookup_key, const Callback& supplied) {
+    SupplyLoaded(lookup_key, supplied, false);
+}
+
+void i18n::addressinput::PreloadingSupplier::SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) {
+    SupplyLoaded(lookup_key, supplied, true);
+}
+
+size_t i18n::addressinput::PreloadingSupplier::GetLoadedRuleDepth(const std::string& region_code) const {
+    return _supplier.GetLoadedRuleDepth(region_code);
+}
+
+void i18n::addressinput::PreloadingSupplier::Load(const std::string& region_code, Loaded done) {
+    if(_supplier.IsLoaded(region_code)) {
+        done(true, 0);
+        return;
+    }
+
+    auto& waiting = _waiting[region_code];
+    waiting.push_back(std::move(done));
+
+    //LoadRules may finish synchronously and erase the entry, so the
+    //reference above can't be used past this point
+    if(waiting.size() == 1) {
+        _supplier.LoadRules(region_code, _loaded);
+    }
+}
+
+bool i18n::addressinput::PreloadingSupplier::IsLoaded(const std::string& region_code) const {
+    return _supplier.IsLoaded(region_code);
+}
+
+i18n::addressinput::PreloadSupplier& i18n::addressinput::PreloadingSupplier::Preloaded() {
+    return _supplier;
+}
+
+void i18n::addressinput::PreloadingSupplier::OnLoaded(bool success, const std::string& region_code, int num_rules) {
+    auto it = _waiting.find(region_code);
+    if(it == _waiting.end()) return;
+
+    auto waiting = std::move(it->second);
+    _waiting.erase(it);
+
+    for(auto& done : waiting) {
+        done(success, num_rules);
+    }
+}
+
+//lookup_key and supplied are guaranteed by the Supplier contract to outlive
+//the supplied callback, so they can be captured by reference across the load.
+void i18n::addressinput::PreloadingSupplier::SupplyLoaded(
+        const LookupKey& lookup_key,
+        const Callback& supplied,
+        bool globally) {
+    const std::string& region_code = lookup_key.GetRegionCode();
+    if(!RegionDataConstants::IsSupported(region_code) || _supplier.IsLoaded(region_code)) {
+        if(globally) {
+            _supplier.SupplyGlobally(lookup_key, supplied);
+        } else {
+            _supplier.Supply(lookup_key, supplied);
+        }
+        return;
+    }
+
+    Load(region_code, [this, &lookup_key, &supplied, globally](bool success, int num_rules) {
+        if(!success) {
+            supplied(false, lookup_key, RuleHierarchy());
+        } else if(globally) {
+            _supplier.SupplyGlobally(lookup_key, supplied);
+        } else {
+            _supplier.Supply(lookup_key, supplied);
+        }
+    });
+}
@@ -0,0 +1,68 @@
+#ifndef INCLUDE_CPP_PRELOADING_SUPPLIER_H_
+#define INCLUDE_CPP_PRELOADING_SUPPLIER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libaddressinput/preload_supplier.h>
+#include <libaddressinput/source.h>
+#include <libaddressinput/storage.h>
+#include <libaddressinput/supplier.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Wraps PreloadSupplier so that a region which hasn't been preloaded yet is
+//loaded in one request the first time it is supplied, instead of reporting the
+//country as unknown. Concurrent loads of the same region share one request.
+class PreloadingSupplier : public Supplier {
+public:
+    using Loaded = std::function<void (bool success, int num_rules)>;
+
+    //Takes ownership of source and storage. The source must serve aggregated
+    //region data, as PreloadSupplier requests whole regions at once.
+    PreloadingSupplier(const Source* source, Storage* storage);
+    ~PreloadingSupplier() override;
+
+    PreloadingSupplier(const PreloadingSupplier&) = delete;
+    PreloadingSupplier& operator=(const PreloadingSupplier&) = delete;
+
+    void Supply(const LookupKey& lookup_key, const Callback& supplied) override;
+    void SupplyGlobally(const LookupKey& lookup_key, const Callback& supplied) override;
+    size_t GetLoadedRuleDepth(const std::string& region_code) const override;
+
+    //Calls done once every rule for region_code is loaded, immediately if it
+    //already is.
+    void Load(const std::string& region_code, Loaded done);
+    bool IsLoaded(const std::string& region_code) const;
+
+    PreloadSupplier& Preloaded();
+
+private:
+    class RegionLoaded : public PreloadSupplier::Callback {
+    public:
+        explicit RegionLoaded(PreloadingSupplier *owner) : _owner(owner) { }
+
+        void operator()(bool success, const std::string& region_code, int num_rules) const override {
+            _owner->OnLoaded(success, region_code, num_rules);
+        }
+
+    private:
+        PreloadingSupplier *_owner;
+    };
+
+    void OnLoaded(bool success, const std::string& region_code, int num_rules);
+    void SupplyLoaded(const LookupKey& lookup_key, const Callback& supplied, bool globally);
+
+    PreloadSupplier _supplier;
+    RegionLoaded _loaded;
+    std::map<std::string, std::vector<Loaded>> _waiting;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_PRELOADING_SUPPLIER_H_
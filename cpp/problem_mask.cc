@@ -0,0 +1,19 @@
+#include "problem_mask.h"
+
+uint32_t i18n::addressinput::ProblemBit(AddressField field, AddressProblem problem) {
+    return static_cast<uint32_t>(field) * kAddressProblemCount + static_cast<uint32_t>(problem);
+}
+
+uint64_t i18n::addressinput::ProblemMask(const FieldProblemMap& problems) {
+    uint64_t mask = 0;
+    for(auto& item : problems) {
+        mask |= uint64_t(1) << ProblemBit(item.first, item.second);
+    }
+    return mask;
+}
+
+void i18n::addressinput::WriteProblemMask(const FieldProblemMap& problems, uint32_t *words) {
+    uint64_t mask = ProblemMask(problems);
+    words[0] = static_cast<uint32_t>(mask);
+    words[1] = static_cast<uint32_t>(mask >> 32);
+}
@@ -0,0 +1,29 @@
+#ifndef INCLUDE_CPP_PROBLEM_MASK_H_
+#define INCLUDE_CPP_PROBLEM_MASK_H_
+
+#include <cstdint>
+
+#include <libaddressinput/address_validator.h>
+
+#include "address_strings.h"
+
+namespace i18n {
+namespace addressinput {
+
+//Compact encoding of a FieldProblemMap as one bit per (field, problem) pair,
+//field * kAddressProblemCount + problem. 9 fields x 7 problems fit in 63 bits.
+static_assert(kAddressFieldCount * kAddressProblemCount <= 64, "Problem mask doesn't fit in 64 bits");
+
+constexpr uint32_t kProblemMaskWords = 2;
+
+uint32_t ProblemBit(AddressField field, AddressProblem problem);
+uint64_t ProblemMask(const FieldProblemMap& problems);
+
+//Writes the mask as kProblemMaskWords little end first 32 bit words, the
+//widest typed array available to every supported target
+void WriteProblemMask(const FieldProblemMap& problems, uint32_t *words);
+
+}
+}
+
+#endif  // INCLUDE_CPP_PROBLEM_MASK_H_
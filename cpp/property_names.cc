@@ -0,0 +1,43 @@
+#include "property_names.h"
+
+#include "addon_data.h"
+
+namespace {
+
+constexpr uint32_t kProblemsOffset = i18n::addressinput::kAddressFieldCount;
+constexpr uint32_t kDataKeysOffset = kProblemsOffset + i18n::addressinput::kAddressProblemCount;
+
+}
+
+PropertyNames::PropertyNames(Napi::Env env) {
+    Napi::Array names = Napi::Array::New(env, kDataKeysOffset + i18n::addressinput::kAddressDataKeyCount);
+    for(uint32_t i = 0; i < i18n::addressinput::kAddressFieldCount; i++) {
+        names.Set(i, Napi::String::New(env,
+                    i18n::addressinput::AddressFieldName(static_cast<i18n::addressinput::AddressField>(i))));
+    }
+    for(uint32_t i = 0; i < i18n::addressinput::kAddressProblemCount; i++) {
+        names.Set(kProblemsOffset + i, Napi::String::New(env,
+                    i18n::addressinput::AddressProblemName(static_cast<i18n::addressinput::AddressProblem>(i))));
+    }
+    for(uint32_t i = 0; i < i18n::addressinput::kAddressDataKeyCount; i++) {
+        names.Set(kDataKeysOffset + i, Napi::String::New(env,
+                    i18n::addressinput::AddressDataKeyName(static_cast<i18n::addressinput::AddressDataKey>(i))));
+    }
+    _names = Napi::Persistent(names.As<Napi::Object>());
+}
+
+const PropertyNames& PropertyNames::For(Napi::Env env) {
+    return AddonData::For(env).names;
+}
+
+Napi::String PropertyNames::Field(i18n::addressinput::AddressField field) const {
+    return _names.Value().Get(static_cast<uint32_t>(field)).As<Napi::String>();
+}
+
+Napi::String PropertyNames::Problem(i18n::addressinput::AddressProblem problem) const {
+    return _names.Value().Get(kProblemsOffset + problem).As<Napi::String>();
+}
+
+Napi::String PropertyNames::DataKey(i18n::addressinput::AddressDataKey key) const {
+    return _names.Value().Get(kDataKeysOffset + key).As<Napi::String>();
+}
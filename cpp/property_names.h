@@ -0,0 +1,29 @@
+#ifndef INCLUDE_CPP_PROPERTY_NAMES_H_
+#define INCLUDE_CPP_PROPERTY_NAMES_H_
+
+#include <napi.h>
+
+#include "address_strings.h"
+
+//JS strings for every property name and enum value put into results, created
+//once per environment so marshalling a result doesn't create them each time.
+class PropertyNames {
+public:
+    explicit PropertyNames(Napi::Env env);
+
+    PropertyNames(const PropertyNames&) = delete;
+    PropertyNames& operator=(const PropertyNames&) = delete;
+
+    static const PropertyNames& For(Napi::Env env);
+
+    Napi::String Field(i18n::addressinput::AddressField field) const;
+    Napi::String Problem(i18n::addressinput::AddressProblem problem) const;
+    Napi::String DataKey(i18n::addressinput::AddressDataKey key) const;
+
+private:
+    //Fields, then problems, then data keys. node-api can't reference strings
+    //themselves before version 10, so they are held by one array instead.
+    Napi::ObjectReference _names;
+};
+
+#endif  // INCLUDE_CPP_PROPERTY_NAMES_H_
@@ -0,0 +1,523 @@
+#include "record_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+//Column slots for CSV, and the fields JSON keys are read into
+enum Slot {
+    IGNORED = -1,
+    ADDRESS_LINES = -2,
+
+    //Separate address_line_N columns are ADDRESS_LINE_N + N
+    ADDRESS_LINE_N = 1000
+};
+
+std::string* string_field(i18n::addressinput::AddressData& address, const std::string& name) {
+    if(name == "region_code") return &address.region_code;
+    if(name == "administrative_area") return &address.administrative_area;
+    if(name == "locality") return &address.locality;
+    if(name == "dependent_locality") return &address.dependent_locality;
+    if(name == "postal_code") return &address.postal_code;
+    if(name == "sorting_code") return &address.sorting_code;
+    if(name == "language_code") return &address.language_code;
+    if(name == "organization") return &address.organization;
+    if(name == "recipient") return &address.recipient;
+    return nullptr;
+}
+
+const char* const kStringFields[] = {
+    "region_code", "administrative_area", "locality", "dependent_locality", "postal_code",
+    "sorting_code", "language_code", "organization", "recipient",
+};
+
+int column_slot(std::string name) {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    for(int i = 0; i < int(sizeof(kStringFields) / sizeof(*kStringFields)); i++) {
+        if(name == kStringFields[i]) return i;
+    }
+    if(name == "address_line") return ADDRESS_LINES;
+
+    const std::string prefix = "address_line_";
+    if(name.compare(0, prefix.size(), prefix) == 0 && name.size() > prefix.size()
+            && name.size() - prefix.size() <= 3
+            && name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+        return ADDRESS_LINE_N + std::stoi(name.substr(prefix.size()));
+    }
+    return IGNORED;
+}
+
+void split_lines(const std::string& value, std::vector<std::string> *lines) {
+    size_t begin = 0;
+    while(begin <= value.size()) {
+        size_t end = value.find('\n', begin);
+        if(end == std::string::npos) end = value.size();
+
+        size_t stop = end;
+        if(stop > begin && value[stop - 1] == '\r') stop--;
+        if(stop > begin) {
+            lines->emplace_back(value, begin, stop - begin);
+        }
+        begin = end + 1;
+    }
+}
+
+void append_utf8(uint32_t cp, std::string *out) {
+    if(cp < 0x80) {
+        out->push_back(char(cp));
+    } else if(cp < 0x800) {
+        out->push_back(char(0xC0 | (cp >> 6)));
+        out->push_back(char(0x80 | (cp & 0x3F)));
+    } else if(cp < 0x10000) {
+        out->push_back(char(0xE0 | (cp >> 12)));
+        out->push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back(char(0x80 | (cp & 0x3F)));
+    } else {
+        out->push_back(char(0xF0 | (cp >> 18)));
+        out->push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+        out->push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back(char(0x80 | (cp & 0x3F)));
+    }
+}
+
+//Reads one JSON object into an AddressData. Only as much of JSON as needed to
+//find the known keys is interpreted, anything else is validated and skipped.
+class JsonReader {
+public:
+    JsonReader(const char *begin, const char *end) : _begin(begin), _p(begin), _end(end) { }
+
+    bool ReadAddress(i18n::addressinput::AddressData *address) {
+        SkipWhitespace();
+        if(!Consume('{')) return Fail("Expected an object");
+
+        SkipWhitespace();
+        if(Consume('}')) return Finish();
+
+        while(true) {
+            std::string key;
+            SkipWhitespace();
+            if(!ReadString(&key)) return false;
+
+            SkipWhitespace();
+            if(!Consume(':')) return Fail("Expected ':'");
+            SkipWhitespace();
+
+            std::string *field = string_field(*address, key);
+            if(field != nullptr) {
+                if(!ReadNullableString(field)) return false;
+            } else if(key == "address_line") {
+                if(!ReadLines(&address->address_line)) return false;
+            } else if(!SkipValue(0)) {
+                return false;
+            }
+
+            SkipWhitespace();
+            if(Consume('}')) return Finish();
+            if(!Consume(',')) return Fail("Expected ',' or '}'");
+        }
+    }
+
+    const std::string& Error() const {
+        return _error;
+    }
+
+private:
+    bool Finish() {
+        SkipWhitespace();
+        return _p == _end || Fail("Unexpected data after the object");
+    }
+
+    bool Fail(const std::string& message) {
+        _error = message + " at column " + std::to_string(_p - _begin + 1);
+        return false;
+    }
+
+    void SkipWhitespace() {
+        while(_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\r' || *_p == '\n')) _p++;
+    }
+
+    bool Consume(char c) {
+        if(_p < _end && *_p == c) {
+            _p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool ConsumeLiteral(const char *literal) {
+        size_t len = std::strlen(literal);
+        if(size_t(_end - _p) >= len && std::memcmp(_p, literal, len) == 0) {
+            _p += len;
+            return true;
+        }
+        return false;
+    }
+
+    bool ReadHex(uint32_t *value) {
+        if(_end - _p < 4) return Fail("Invalid unicode escape");
+        *value = 0;
+        for(int i = 0; i < 4; i++) {
+            char c = *_p++;
+            *value <<= 4;
+            if(c >= '0' && c <= '9') *value |= c - '0';
+            else if(c >= 'a' && c <= 'f') *value |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F') *value |= c - 'A' + 10;
+            else return Fail("Invalid unicode escape");
+        }
+        return true;
+    }
+
+    bool ReadString(std::string *out) {
+        if(!Consume('"')) return Fail("Expected a string");
+
+        while(_p < _end) {
+            //Copy runs of plain characters at once
+            const char *run = _p;
+            while(_p < _end && *_p != '"' && *_p != '\\' && (unsigned char)*_p >= 0x20) _p++;
+            out->append(run, _p - run);
+
+            if(_p == _end) break;
+            char c = *_p++;
+            if(c == '"') return true;
+            if(c != '\\') {
+                _p--;
+                return Fail("Control character in string");
+            }
+
+            if(_p == _end) break;
+            switch(*_p++) {
+                case '"': out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/': out->push_back('/'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    uint32_t cp;
+                    if(!ReadHex(&cp)) return false;
+                    if(cp >= 0xD800 && cp < 0xDC00) {
+                        uint32_t low;
+                        if(!ConsumeLiteral("\\u") || !ReadHex(&low) || low < 0xDC00 || low >= 0xE000) {
+                            return Fail("Invalid surrogate pair");
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(cp, out);
+                    break;
+                }
+                default:
+                    _p--;
+                    return Fail("Invalid escape");
+            }
+        }
+        return Fail("Unterminated string");
+    }
+
+    bool ReadNullableString(std::string *out) {
+        if(ConsumeLiteral("null")) return true;
+        return ReadString(out);
+    }
+
+    bool ReadLines(std::vector<std::string> *lines) {
+        if(ConsumeLiteral("null")) return true;
+        if(_p < _end && *_p == '"') {
+            std::string line;
+            if(!ReadString(&line)) return false;
+            split_lines(line, lines);
+            return true;
+        }
+
+        if(!Consume('[')) return Fail("Expected an array of strings");
+        SkipWhitespace();
+        if(Consume(']')) return true;
+
+        while(true) {
+            SkipWhitespace();
+            lines->emplace_back();
+            if(!ReadString(&lines->back())) return false;
+
+            SkipWhitespace();
+            if(Consume(']')) return true;
+            if(!Consume(',')) return Fail("Expected ',' or ']'");
+        }
+    }
+
+    bool SkipValue(int depth) {
+        if(depth > 64) return Fail("Nested too deeply");
+        if(_p == _end) return Fail("Expected a value");
+
+        std::string ignored;
+        switch(*_p) {
+            case '"':
+                return ReadString(&ignored);
+            case '{':
+            case '[': {
+                char close = *_p == '{' ? '}' : ']';
+                _p++;
+                SkipWhitespace();
+                if(Consume(close)) return true;
+
+                while(true) {
+                    SkipWhitespace();
+                    if(close == '}') {
+                        ignored.clear();
+                        if(!ReadString(&ignored)) return false;
+                        SkipWhitespace();
+                        if(!Consume(':')) return Fail("Expected ':'");
+                        SkipWhitespace();
+                    }
+                    if(!SkipValue(depth + 1)) return false;
+
+                    SkipWhitespace();
+                    if(Consume(close)) return true;
+                    if(!Consume(',')) return Fail(std::string("Expected ',' or '") + close + "'");
+                }
+            }
+            default:
+                if(ConsumeLiteral("true") || ConsumeLiteral("false") || ConsumeLiteral("null")) return true;
+
+                const char *start = _p;
+                while(_p < _end && std::strchr("+-.eE0123456789", *_p) != nullptr) _p++;
+                return _p != start || Fail("Expected a value");
+        }
+    }
+
+    const char *_begin;
+    const char *_p;
+    const char *_end;
+    std::string _error;
+};
+
+}
+
+i18n::addressinput::AddressRecordParser::AddressRecordParser(Format format, size_t max_record_bytes)
+    : _format(format)
+    , _max_record_bytes(max_record_bytes)
+    , _taken(0)
+    , _record_line(1)
+    , _line(1)
+    , _record_bytes(0)
+    , _overflowed(false)
+    , _in_quotes(false)
+    , _quote_pending(false)
+    , _field_started(false)
+    , _have_header(false) { }
+
+void i18n::addressinput::AddressRecordParser::Write(const char *data, size_t size) {
+    if(_format == NDJSON) {
+        WriteLines(data, size);
+    } else {
+        WriteCsv(data, size);
+    }
+}
+
+void i18n::addressinput::AddressRecordParser::End() {
+    if(_format == NDJSON) {
+        if(!_overflowed && !_partial.empty()) {
+            ParseJsonLine(_partial.data(), _partial.size());
+        }
+        _partial.clear();
+    } else if(_in_quotes && !_quote_pending) {
+        if(!_overflowed) {
+            _records.push_back(ParsedRecord{AddressData(), _record_line, "Unterminated quoted field"});
+        }
+        _fields.clear();
+        _field.clear();
+    } else if(_field_started || !_field.empty() || !_fields.empty()) {
+        EndCsvField();
+        EndCsvRecord();
+    }
+
+    _in_quotes = false;
+    _quote_pending = false;
+    _overflowed = false;
+    _record_bytes = 0;
+}
+
+size_t i18n::addressinput::AddressRecordParser::Pending() const {
+    return _records.size();
+}
+
+uint64_t i18n::addressinput::AddressRecordParser::Taken() const {
+    return _taken;
+}
+
+std::vector<i18n::addressinput::ParsedRecord> i18n::addressinput::AddressRecordParser::Take(size_t max) {
+    size_t count = std::min(max, _records.size());
+    std::vector<ParsedRecord> ret(
+            std::make_move_iterator(_records.begin()),
+            std::make_move_iterator(_records.begin() + count));
+    _records.erase(_records.begin(), _records.begin() + count);
+    _taken += count;
+    return ret;
+}
+
+void i18n::addressinput::AddressRecordParser::WriteLines(const char *data, size_t size) {
+    const char *p = data;
+    const char *end = data + size;
+
+    while(p < end) {
+        const char *newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char *stop = newline != nullptr ? newline : end;
+        size_t length = stop - p;
+
+        if(!_overflowed) {
+            if(_partial.size() + length > _max_record_bytes) {
+                Overflowed();
+                _partial.clear();
+            } else if(newline != nullptr && _partial.empty()) {
+                //Whole line in this write, parsed without copying it
+                ParseJsonLine(p, length);
+            } else {
+                _partial.append(p, length);
+                if(newline != nullptr) {
+                    ParseJsonLine(_partial.data(), _partial.size());
+                    _partial.clear();
+                }
+            }
+        }
+
+        if(newline == nullptr) break;
+
+        _overflowed = false;
+        _line++;
+        _record_line = _line;
+        p = newline + 1;
+    }
+}
+
+void i18n::addressinput::AddressRecordParser::ParseJsonLine(const char *data, size_t size) {
+    while(size > 0 && (data[size - 1] == '\r' || data[size - 1] == ' ' || data[size - 1] == '\t')) size--;
+    size_t start = 0;
+    while(start < size && (data[start] == ' ' || data[start] == '\t')) start++;
+    if(start == size) return;
+
+    ParsedRecord record{AddressData(), _record_line, ""};
+    JsonReader reader(data + start, data + size);
+    if(!reader.ReadAddress(&record.address)) {
+        record.address = AddressData();
+        record.error = reader.Error();
+    }
+    _records.push_back(std::move(record));
+}
+
+void i18n::addressinput::AddressRecordParser::WriteCsv(const char *data, size_t size) {
+    for(const char *p = data; p < data + size; p++) {
+        char c = *p;
+
+        if(!_overflowed && ++_record_bytes > _max_record_bytes) {
+            Overflowed();
+            _fields.clear();
+            _field.clear();
+        }
+
+        if(_in_quotes) {
+            if(_quote_pending) {
+                _quote_pending = false;
+                if(c == '"') {
+                    //Escaped quote
+                    if(!_overflowed) _field.push_back('"');
+                    continue;
+                }
+                _in_quotes = false;
+            } else if(c == '"') {
+                _quote_pending = true;
+                continue;
+            } else {
+                if(c == '\n') _line++;
+                if(!_overflowed) _field.push_back(c);
+                continue;
+            }
+        }
+
+        switch(c) {
+            case '"':
+                if(!_field_started) {
+                    _in_quotes = true;
+                    _field_started = true;
+                } else if(!_overflowed) {
+                    _field.push_back(c);
+                }
+                break;
+            case ',':
+                EndCsvField();
+                break;
+            case '\n':
+                EndCsvField();
+                EndCsvRecord();
+                _line++;
+                _record_line = _line;
+                break;
+            case '\r':
+                break;
+            default:
+                _field_started = true;
+                if(!_overflowed) _field.push_back(c);
+        }
+    }
+}
+
+void i18n::addressinput::AddressRecordParser::EndCsvField() {
+    if(!_overflowed) {
+        _fields.push_back(std::move(_field));
+    }
+    _field.clear();
+    _field_started = false;
+}
+
+void i18n::addressinput::AddressRecordParser::EndCsvRecord() {
+    bool blank = _fields.size() == 1 && _fields[0].empty();
+
+    if(_overflowed || blank) {
+        //Overflowed records were already reported
+    } else if(!_have_header) {
+        for(auto& name : _fields) {
+            _columns.push_back(column_slot(name));
+        }
+        _have_header = true;
+    } else {
+        ParsedRecord record{AddressData(), _record_line, ""};
+        std::vector<std::pair<int, std::string*>> numbered_lines;
+
+        for(size_t i = 0; i < _fields.size() && i < _columns.size(); i++) {
+            int slot = _columns[i];
+            if(slot >= ADDRESS_LINE_N) {
+                numbered_lines.emplace_back(slot, &_fields[i]);
+            } else if(slot == ADDRESS_LINES) {
+                split_lines(_fields[i], &record.address.address_line);
+            } else if(slot >= 0) {
+                *string_field(record.address, kStringFields[slot]) = std::move(_fields[i]);
+            }
+        }
+
+        std::stable_sort(numbered_lines.begin(), numbered_lines.end(),
+                [](const std::pair<int, std::string*>& a, const std::pair<int, std::string*>& b) {
+                    return a.first < b.first;
+                });
+        for(auto& line : numbered_lines) {
+            if(!line.second->empty()) {
+                record.address.address_line.push_back(std::move(*line.second));
+            }
+        }
+
+        _records.push_back(std::move(record));
+    }
+
+    _fields.clear();
+    _overflowed = false;
+    _record_bytes = 0;
+}
+
+void i18n::addressinput::AddressRecordParser::Overflowed() {
+    _records.push_back(ParsedRecord{AddressData(), _record_line,
+            "Record exceeds " + std::to_string(_max_record_bytes) + " bytes"});
+    _overflowed = true;
+}
@@ -0,0 +1,90 @@
+#ifndef INCLUDE_CPP_RECORD_PARSER_H_
+#define INCLUDE_CPP_RECORD_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <libaddressinput/address_data.h>
+
+namespace i18n {
+namespace addressinput {
+
+struct ParsedRecord {
+    AddressData address;
+
+    //1 based line the record started on
+    uint64_t line;
+
+    //Set when the record couldn't be parsed, address is empty then
+    std::string error;
+};
+
+//Incremental parser turning NDJSON or CSV bytes into AddressData, fed in
+//arbitrary chunks. Records are keyed by the AddressData property names
+//("region_code", "address_line", ...). In CSV those come from the header row,
+//where "address_line_1", "address_line_2"... may be used for separate lines
+//and a plain "address_line" column is split on newlines. Unknown keys and
+//columns are ignored. Memory is bounded by the parsed records not yet taken
+//plus one record of at most max_record_bytes.
+class AddressRecordParser {
+public:
+    enum Format { NDJSON, CSV };
+
+    AddressRecordParser(Format format, size_t max_record_bytes);
+
+    void Write(const char *data, size_t size);
+
+    //Flushes a final record without a trailing newline
+    void End();
+
+    size_t Pending() const;
+
+    //Records handed out by Take so far, i.e. the index of the next one
+    uint64_t Taken() const;
+
+    std::vector<ParsedRecord> Take(size_t max);
+
+private:
+    void WriteLines(const char *data, size_t size);
+    void WriteCsv(const char *data, size_t size);
+
+    void ParseJsonLine(const char *data, size_t size);
+    void EndCsvField();
+    void EndCsvRecord();
+    void Overflowed();
+
+    Format _format;
+    size_t _max_record_bytes;
+
+    std::deque<ParsedRecord> _records;
+    uint64_t _taken;
+
+    //Line the current record started on, and the line being read
+    uint64_t _record_line;
+    uint64_t _line;
+
+    //Bytes of the current record seen so far, which is discarded up to its
+    //end once it grows past the limit
+    size_t _record_bytes;
+    bool _overflowed;
+
+    //NDJSON: start of a line split across writes
+    std::string _partial;
+
+    //CSV state
+    std::vector<std::string> _fields;
+    std::string _field;
+    bool _in_quotes;
+    bool _quote_pending;
+    bool _field_started;
+    std::vector<int> _columns;
+    bool _have_header;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_RECORD_PARSER_H_
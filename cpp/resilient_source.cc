@@ -0,0 +1,251 @@
+#include "resilient_source.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <utility>
+
+#include "timers.h"
+#include "validating_util.h"
+
+//One logical fetch of a key, including its retries. Reports to data_ready, or
+//when refreshing in the background (data_ready is null) writes the result to
+//storage itself. Deletes itself once done.
+class i18n::addressinput::ResilientSource::Attempt : public Source::Callback {
+public:
+    Attempt(const ResilientSource *owner, const std::string& key, const Source::Callback *data_ready)
+        : _owner(owner), _alive(owner->_alive), _key(key), _data_ready(data_ready), _attempt(0) { }
+
+    void Start() const {
+        _owner->_source->Get(_key, *this);
+    }
+
+    void operator()(bool success, const std::string& key, std::string *data) const override {
+        if(!*_alive) {
+            delete data;
+            delete this;
+            return;
+        }
+
+        if(success) {
+            _owner->Succeeded(_key);
+            Finish(true, data);
+            return;
+        }
+        delete data;
+
+        if(_attempt < _owner->_policy.retries) {
+            double delay = _owner->Backoff(_attempt++);
+            _owner->_retries++;
+
+            auto alive = _alive;
+            set_timeout(_owner->_env, [this, alive]() {
+                if(*alive) {
+                    Start();
+                } else {
+                    delete this;
+                }
+            }, delay, _data_ready != nullptr);
+            return;
+        }
+
+        _owner->Failed(_key);
+        Finish(false, nullptr);
+    }
+
+private:
+    void Finish(bool success, std::string *data) const {
+        if(_data_ready != nullptr) {
+            (*_data_ready)(success, _key, data);
+        } else {
+            _owner->_refreshing.erase(_key);
+            if(success) {
+                _owner->_refreshed[_key] = *data;
+
+                //Stored the same way ValidatingStorage would, so the next
+                //load sees it as fresh
+                ValidatingUtil::Wrap(std::time(nullptr), data);
+                _owner->_storage->Put(_key, data);
+                if(_owner->_on_refreshed) _owner->_on_refreshed(_key);
+            }
+        }
+        delete this;
+    }
+
+    const ResilientSource *_owner;
+    std::shared_ptr<bool> _alive;
+    std::string _key;
+    const Source::Callback *_data_ready;
+    mutable uint32_t _attempt;
+};
+
+//One read through an Observer. Hands the data on untouched and deletes itself.
+class i18n::addressinput::ResilientSource::Read : public Storage::Callback {
+public:
+    Read(const ResilientSource *owner, std::shared_ptr<bool> alive, const Storage::Callback& data_ready)
+        : _owner(owner), _alive(std::move(alive)), _data_ready(data_ready) { }
+
+    void operator()(bool success, const std::string& key, std::string *data) const override {
+        if(*_alive && success && data != nullptr && !data->empty()) {
+            //The timestamp is the first line, so the rest is only copied
+            //when it has expired
+            size_t header = data->find('\n');
+            std::string copy(*data, 0, header == std::string::npos ? header : header + 1);
+            if(ValidatingUtil::UnwrapTimestamp(&copy, std::time(nullptr))) {
+                _owner->_refreshed.erase(key);
+            } else {
+                copy = *data;
+                ValidatingUtil::UnwrapTimestamp(&copy, std::time(nullptr));
+                if(ValidatingUtil::UnwrapChecksum(&copy)) _owner->_stale.insert(key);
+            }
+        }
+        _data_ready(success, key, data);
+        delete this;
+    }
+
+private:
+    const ResilientSource *_owner;
+    std::shared_ptr<bool> _alive;
+    const Storage::Callback& _data_ready;
+};
+
+//Storage the supplier reads through, noting which keys it finds only an
+//expired but intact copy of. libaddressinput's Retriever keeps such a copy and
+//falls back to it when the source fails, so the source learns it can fail
+//fast without reading storage a second time.
+class i18n::addressinput::ResilientSource::Observer : public Storage {
+public:
+    Observer(const ResilientSource *owner, Storage *storage)
+        : _owner(owner), _alive(owner->_alive), _storage(storage) { }
+
+    void Put(const std::string& key, std::string *data) override {
+        _storage->Put(key, data);
+    }
+
+    void Get(const std::string& key, const Callback& data_ready) const override {
+        _storage->Get(key, *new Read(_owner, _alive, data_ready));
+    }
+
+private:
+    const ResilientSource *_owner;
+    std::shared_ptr<bool> _alive;
+    std::unique_ptr<Storage> _storage;
+};
+
+i18n::addressinput::ResilientSource::ResilientSource(
+        const Source* source,
+        Storage* storage,
+        Napi::Env env,
+        const ResiliencePolicy& policy)
+    : _source(source)
+    , _storage(storage)
+    , _env(env)
+    , _policy(policy)
+    , _alive(std::make_shared<bool>(true))
+    , _jitter(std::random_device()())
+    , _retries(0)
+    , _failures(0)
+    , _negative_hits(0)
+    , _stale_served(0)
+    , _refreshes(0) { }
+
+i18n::addressinput::ResilientSource::~ResilientSource() {
+    *_alive = false;
+}
+
+void i18n::addressinput::ResilientSource::Get(const std::string& key, const Callback& data_ready) const {
+    bool stale = _stale.erase(key) > 0;
+
+    auto refreshed = _refreshed.find(key);
+    if(refreshed != _refreshed.end()) {
+        auto data = new std::string(std::move(refreshed->second));
+        _refreshed.erase(refreshed);
+        data_ready(true, key, data);
+        return;
+    }
+
+    auto failed = _failed_until.find(key);
+    if(failed != _failed_until.end()) {
+        if(Clock::now() < failed->second) {
+            _negative_hits++;
+            data_ready(false, key, nullptr);
+            return;
+        }
+        _failed_until.erase(failed);
+    }
+
+    if(stale && _policy.stale_while_revalidate) {
+        //libaddressinput's Retriever reuses its stale copy when the source
+        //fails, so failing now serves stale data immediately
+        _stale_served++;
+        Refresh(key);
+        data_ready(false, key, nullptr);
+    } else {
+        Fetch(key, &data_ready);
+    }
+}
+
+i18n::addressinput::Storage* i18n::addressinput::ResilientSource::Observe(Storage* storage) {
+    return new Observer(this, storage);
+}
+
+void i18n::addressinput::ResilientSource::SetRefreshed(std::function<void (const std::string& key)> refreshed) {
+    _on_refreshed = std::move(refreshed);
+}
+
+uint64_t i18n::addressinput::ResilientSource::Retries() const {
+    return _retries;
+}
+
+uint64_t i18n::addressinput::ResilientSource::Failures() const {
+    return _failures;
+}
+
+uint64_t i18n::addressinput::ResilientSource::NegativeHits() const {
+    return _negative_hits;
+}
+
+uint64_t i18n::addressinput::ResilientSource::StaleServed() const {
+    return _stale_served;
+}
+
+uint64_t i18n::addressinput::ResilientSource::Refreshes() const {
+    return _refreshes;
+}
+
+void i18n::addressinput::ResilientSource::ResetCounters() {
+    _retries = 0;
+    _failures = 0;
+    _negative_hits = 0;
+    _stale_served = 0;
+    _refreshes = 0;
+}
+
+void i18n::addressinput::ResilientSource::Fetch(const std::string& key, const Callback *data_ready) const {
+    (new Attempt(this, key, data_ready))->Start();
+}
+
+void i18n::addressinput::ResilientSource::Refresh(const std::string& key) const {
+    if(!_refreshing.insert(key).second) return;
+
+    _refreshes++;
+    Fetch(key, nullptr);
+}
+
+void i18n::addressinput::ResilientSource::Failed(const std::string& key) const {
+    _failures++;
+    if(_policy.negative_ttl_ms > 0) {
+        _failed_until[key] = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>(_policy.negative_ttl_ms));
+    }
+}
+
+void i18n::addressinput::ResilientSource::Succeeded(const std::string& key) const {
+    _failed_until.erase(key);
+}
+
+double i18n::addressinput::ResilientSource::Backoff(uint32_t attempt) const {
+    double delay = std::min(_policy.max_backoff_ms, _policy.backoff_ms * std::pow(2.0, attempt));
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    return delay * jitter(_jitter);
+}
@@ -0,0 +1,112 @@
+#ifndef INCLUDE_CPP_RESILIENT_SOURCE_H_
+#define INCLUDE_CPP_RESILIENT_SOURCE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include <napi.h>
+
+#include <libaddressinput/source.h>
+#include <libaddressinput/storage.h>
+
+namespace i18n {
+namespace addressinput {
+
+struct ResiliencePolicy {
+    //How long a key that failed every attempt fails fast. 0 disables.
+    double negative_ttl_ms = 0;
+
+    //Additional attempts after the first failure, spaced by exponential
+    //backoff starting at backoff_ms with +/-50% jitter
+    uint32_t retries = 0;
+    double backoff_ms = 100;
+    double max_backoff_ms = 5000;
+
+    //Fail fast when storage still holds an expired copy of the key, which
+    //makes libaddressinput fall back to it, and refresh it in the background
+    bool stale_while_revalidate = false;
+};
+
+//Policy layer around a Source whose failures would otherwise be retried by
+//every following validation. Must only be used from the JS main thread, as
+//retries are scheduled with setTimeout.
+class ResilientSource : public Source {
+public:
+    //Takes ownership of source. storage is the unwrapped store the supplier
+    //persists to, where refreshed data is written, and isn't owned.
+    ResilientSource(const Source* source, Storage* storage, Napi::Env env, const ResiliencePolicy& policy);
+    ~ResilientSource() override;
+
+    ResilientSource(const ResilientSource&) = delete;
+    ResilientSource& operator=(const ResilientSource&) = delete;
+
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+    //Wraps the storage the supplier reads from, taking ownership of it, so
+    //that stale-while-revalidate sees which keys it only found expired copies
+    //of. Those are the keys it goes on to fetch from this source.
+    Storage* Observe(Storage* storage);
+
+    //Called with a key once its refreshed data has been stored, e.g. to drop
+    //rules parsed from the stale copy so they're loaded again
+    void SetRefreshed(std::function<void (const std::string& key)> refreshed);
+
+    uint64_t Retries() const;
+    uint64_t Failures() const;
+    uint64_t NegativeHits() const;
+    uint64_t StaleServed() const;
+    uint64_t Refreshes() const;
+    void ResetCounters();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    class Attempt;
+    class Observer;
+    class Read;
+
+    void Fetch(const std::string& key, const Callback *data_ready) const;
+    void Refresh(const std::string& key) const;
+    void Failed(const std::string& key) const;
+    void Succeeded(const std::string& key) const;
+    double Backoff(uint32_t attempt) const;
+
+    std::unique_ptr<const Source> _source;
+    Storage *_storage;
+    Napi::Env _env;
+    ResiliencePolicy _policy;
+
+    //Cleared on destruction so that pending timers and callbacks don't touch
+    //a source that no longer exists
+    std::shared_ptr<bool> _alive;
+
+    mutable std::unordered_map<std::string, Clock::time_point> _failed_until;
+    mutable std::set<std::string> _refreshing;
+
+    //Keys the supplier has just read an expired copy of
+    mutable std::set<std::string> _stale;
+
+    //Refreshed data not yet read back from storage. Served in place of the
+    //stale copy should storage not hold it yet, e.g. while a put is pending.
+    mutable std::unordered_map<std::string, std::string> _refreshed;
+    std::function<void (const std::string&)> _on_refreshed;
+
+    mutable std::minstd_rand _jitter;
+
+    mutable uint64_t _retries;
+    mutable uint64_t _failures;
+    mutable uint64_t _negative_hits;
+    mutable uint64_t _stale_served;
+    mutable uint64_t _refreshes;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_RESILIENT_SOURCE_H_
@@ -0,0 +1,175 @@
+#include "result_cache.h"
+
+namespace {
+
+//Past this many distinct rule keys, e.g. with a stream of misspelled admin
+//areas, any key not yet seen is treated as fetched again
+constexpr size_t kMaxFetchedKeys = 10000;
+
+void append_field(std::string *key, const std::string& value) {
+    //Length prefixed so values can't run into each other
+    key->append(std::to_string(value.size()));
+    key->push_back(':');
+    key->append(value);
+}
+
+//Rough heap footprint of a cached entry, counting the key twice as it is
+//stored in both the list and the index
+size_t entry_bytes(const std::string& key, const std::string& region, const i18n::addressinput::FieldProblemMap& problems) {
+    return 2 * key.size() + region.size() + problems.size() * 48 + 128;
+}
+
+class Observed : public i18n::addressinput::Source::Callback {
+public:
+    Observed(std::shared_ptr<i18n::addressinput::ResultCache> results, const i18n::addressinput::Source::Callback& data_ready)
+        : _results(results), _data_ready(data_ready) { }
+
+    void operator()(bool success, const std::string& key, std::string *data) const override {
+        if(success) {
+            _results->Fetched(key);
+        }
+        _data_ready(success, key, data);
+        delete this;
+    }
+
+private:
+    std::shared_ptr<i18n::addressinput::ResultCache> _results;
+    const i18n::addressinput::Source::Callback& _data_ready;
+};
+
+}
+
+i18n::addressinput::ResultCache::ResultCache(size_t max_entries, size_t max_bytes)
+    : _max_entries(max_entries)
+    , _max_bytes(max_bytes)
+    , _bytes(0)
+    , _hits(0)
+    , _misses(0)
+    , _evictions(0) { }
+
+std::string i18n::addressinput::ResultCache::Key(
+        const AddressData& address,
+        bool allow_postal,
+        bool require_name,
+        const FieldProblemMap& filter) {
+    std::string key;
+    key.push_back(allow_postal ? 'P' : '-');
+    key.push_back(require_name ? 'N' : '-');
+
+    append_field(&key, address.region_code);
+    key.append(std::to_string(address.address_line.size()));
+    key.push_back('[');
+    for(auto& line : address.address_line) {
+        append_field(&key, line);
+    }
+    append_field(&key, address.administrative_area);
+    append_field(&key, address.locality);
+    append_field(&key, address.dependent_locality);
+    append_field(&key, address.postal_code);
+    append_field(&key, address.sorting_code);
+    append_field(&key, address.language_code);
+    append_field(&key, address.organization);
+    append_field(&key, address.recipient);
+
+    //A multimap, so equal filters always iterate in the same order
+    key.push_back('|');
+    for(auto& item : filter) {
+        key.push_back('a' + item.first);
+        key.push_back('a' + item.second);
+    }
+
+    return key;
+}
+
+bool i18n::addressinput::ResultCache::Get(const std::string& key, FieldProblemMap *problems) {
+    auto it = _index.find(key);
+    if(it == _index.end()) {
+        _misses++;
+        return false;
+    }
+
+    _hits++;
+    _lru.splice(_lru.begin(), _lru, it->second);
+    *problems = it->second->problems;
+    return true;
+}
+
+void i18n::addressinput::ResultCache::Insert(const std::string& key, const std::string& region, const FieldProblemMap& problems) {
+    size_t bytes = entry_bytes(key, region, problems);
+    if(_max_entries == 0 || bytes > _max_bytes) return;
+
+    auto existing = _index.find(key);
+    if(existing != _index.end()) {
+        Erase(existing->second);
+    }
+
+    _lru.push_front(Entry{key, region, problems, bytes});
+    _index.emplace(key, _lru.begin());
+    _bytes += bytes;
+
+    while(_lru.size() > _max_entries || _bytes > _max_bytes) {
+        Erase(std::prev(_lru.end()));
+        _evictions++;
+    }
+}
+
+void i18n::addressinput::ResultCache::Fetched(const std::string& rule_key) {
+    if(_fetched.size() < kMaxFetchedKeys && _fetched.insert(rule_key).second) return;
+
+    //"data/US/CA--fr" -> "US"
+    size_t begin = rule_key.find('/');
+    if(begin == std::string::npos) return;
+    size_t end = rule_key.find_first_of("/-", begin + 1);
+    InvalidateRegion(rule_key.substr(begin + 1, end == std::string::npos ? end : end - begin - 1));
+}
+
+void i18n::addressinput::ResultCache::InvalidateRegion(const std::string& region) {
+    for(auto it = _lru.begin(); it != _lru.end(); ) {
+        auto next = std::next(it);
+        if(it->region == region) {
+            Erase(it);
+        }
+        it = next;
+    }
+}
+
+size_t i18n::addressinput::ResultCache::Size() const {
+    return _lru.size();
+}
+
+size_t i18n::addressinput::ResultCache::Bytes() const {
+    return _bytes;
+}
+
+uint64_t i18n::addressinput::ResultCache::Hits() const {
+    return _hits;
+}
+
+uint64_t i18n::addressinput::ResultCache::Misses() const {
+    return _misses;
+}
+
+uint64_t i18n::addressinput::ResultCache::Evictions() const {
+    return _evictions;
+}
+
+void i18n::addressinput::ResultCache::ResetCounters() {
+    _hits = 0;
+    _misses = 0;
+    _evictions = 0;
+}
+
+void i18n::addressinput::ResultCache::Erase(std::list<Entry>::iterator it) {
+    _bytes -= it->bytes;
+    _index.erase(it->key);
+    _lru.erase(it);
+}
+
+i18n::addressinput::ResultInvalidatingSource::ResultInvalidatingSource(
+        const Source* source,
+        std::shared_ptr<ResultCache> results)
+    : _source(source), _results(results) { }
+
+void i18n::addressinput::ResultInvalidatingSource::Get(const std::string& key, const Callback& data_ready) const {
+    _source->Get(key, *new Observed(_results, data_ready));
+}
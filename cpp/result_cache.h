@@ -0,0 +1,93 @@
+#ifndef INCLUDE_CPP_RESULT_CACHE_H_
+#define INCLUDE_CPP_RESULT_CACHE_H_
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include <libaddressinput/address_data.h>
+#include <libaddressinput/address_validator.h>
+#include <libaddressinput/source.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Bounded LRU of validation results. Entries are keyed by every input of
+//AddressValidator::Validate, so a hit is exactly what validating again would
+//report. Only used from the JS main thread.
+class ResultCache {
+public:
+    ResultCache(size_t max_entries, size_t max_bytes);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    static std::string Key(
+            const AddressData& address,
+            bool allow_postal,
+            bool require_name,
+            const FieldProblemMap& filter);
+
+    //Copies the cached problems into problems and refreshes the entry
+    bool Get(const std::string& key, FieldProblemMap *problems);
+    void Insert(const std::string& key, const std::string& region, const FieldProblemMap& problems);
+
+    //Called with every rule key ("data/US/CA") fetched from the source. Data
+    //fetched again for a key means the region's rules may have changed, so
+    //its results are dropped. Only a bounded number of keys is remembered,
+    //past which every fetch drops its region's results.
+    void Fetched(const std::string& rule_key);
+    void InvalidateRegion(const std::string& region);
+
+    size_t Size() const;
+    size_t Bytes() const;
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+    uint64_t Evictions() const;
+    void ResetCounters();
+
+private:
+    struct Entry {
+        std::string key;
+        std::string region;
+        FieldProblemMap problems;
+        size_t bytes;
+    };
+
+    void Erase(std::list<Entry>::iterator it);
+
+    size_t _max_entries;
+    size_t _max_bytes;
+
+    //Most recently used first
+    std::list<Entry> _lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    std::set<std::string> _fetched;
+
+    size_t _bytes;
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _evictions;
+};
+
+//Reports every successful fetch of the wrapped source to a ResultCache
+class ResultInvalidatingSource : public Source {
+public:
+    //Takes ownership of source
+    ResultInvalidatingSource(const Source* source, std::shared_ptr<ResultCache> results);
+
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+private:
+    std::unique_ptr<const Source> _source;
+    std::shared_ptr<ResultCache> _results;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_RESULT_CACHE_H_
@@ -0,0 +1,137 @@
+#include "rule_cache.h"
+
+#include <iterator>
+
+#include "rule.h"
+
+namespace {
+
+//RE2 doesn't report its memory use. A compiled instruction takes about this
+//much once the program's own bookkeeping is counted in, and the lazily built
+//DFA of a postal code pattern rarely grows past a few states.
+constexpr size_t kBytesPerInstruction = 16;
+constexpr size_t kMatcherOverhead = sizeof(RE2) + 2048;
+
+//"data/US/CA--fr" -> "US"
+std::string region_code(const std::string& key) {
+    size_t begin = key.find('/');
+    if(begin == std::string::npos) return key;
+    size_t end = key.find_first_of("/-", begin + 1);
+    return key.substr(begin + 1, end == std::string::npos ? end : end - begin - 1);
+}
+
+}
+
+i18n::addressinput::RuleCache::RuleCache(size_t max_bytes)
+    : _max_bytes(max_bytes), _bytes(0), _evictions(0) { }
+
+std::shared_ptr<const i18n::addressinput::Rule>
+i18n::addressinput::RuleCache::Get(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _rules.find(key);
+    if(it == _rules.end()) return nullptr;
+
+    Touch(key);
+    return it->second.rule;
+}
+
+std::shared_ptr<const i18n::addressinput::Rule>
+i18n::addressinput::RuleCache::Insert(const std::string& key, std::shared_ptr<const Rule> rule, size_t bytes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto inserted = _rules.emplace(key, Entry{std::move(rule), bytes});
+    auto region = Touch(key);
+    if(inserted.second) {
+        region->keys.push_back(key);
+        region->bytes += bytes;
+        _bytes += bytes;
+        Trim();
+    }
+    return inserted.first->second.rule;
+}
+
+void i18n::addressinput::RuleCache::DropRegion(const std::string& key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _regions.find(region_code(key));
+    if(it != _regions.end()) Drop(it->second);
+}
+
+size_t i18n::addressinput::RuleCache::Size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rules.size();
+}
+
+size_t i18n::addressinput::RuleCache::Bytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+size_t i18n::addressinput::RuleCache::MaxBytes() const {
+    return _max_bytes;
+}
+
+uint64_t i18n::addressinput::RuleCache::Evictions() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _evictions;
+}
+
+void i18n::addressinput::RuleCache::ResetCounters() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _evictions = 0;
+}
+
+size_t i18n::addressinput::RuleCache::EstimateBytes(const Rule& rule, size_t data_size) {
+    //Parsed fields are mostly copies of the data they came from
+    size_t bytes = sizeof(Rule) + data_size;
+
+    const RE2ptr *matcher = rule.GetPostalCodeMatcher();
+    if(matcher != nullptr && matcher->ptr != nullptr) {
+        bytes += kMatcherOverhead + matcher->ptr->pattern().size()
+            + matcher->ptr->ProgramSize() * kBytesPerInstruction;
+    }
+    return bytes;
+}
+
+std::list<i18n::addressinput::RuleCache::Region>::iterator
+i18n::addressinput::RuleCache::Touch(const std::string& key) const {
+    std::string code = region_code(key);
+    auto it = _regions.find(code);
+    if(it == _regions.end()) {
+        _lru.push_front(Region{code, {}, 0});
+        it = _regions.emplace(code, _lru.begin()).first;
+    } else {
+        _lru.splice(_lru.begin(), _lru, it->second);
+    }
+    return it->second;
+}
+
+void i18n::addressinput::RuleCache::Trim() {
+    if(_max_bytes == 0) return;
+
+    while(_bytes > _max_bytes && _lru.size() > 1) {
+        _evictions += _lru.back().keys.size();
+        Drop(std::prev(_lru.end()));
+    }
+}
+
+void i18n::addressinput::RuleCache::Drop(std::list<Region>::iterator region) {
+    for(const auto& key : region->keys) {
+        _rules.erase(key);
+    }
+    _bytes -= region->bytes;
+
+    _regions.erase(region->code);
+    _lru.erase(region);
+}
+
+std::shared_ptr<i18n::addressinput::RuleCache> i18n::addressinput::RuleCache::Shared() {
+    static std::mutex mutex;
+    static std::weak_ptr<RuleCache> shared;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cache = shared.lock();
+    if(!cache) {
+        cache = std::make_shared<RuleCache>();
+        shared = cache;
+    }
+    return cache;
+}
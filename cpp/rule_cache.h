@@ -0,0 +1,93 @@
+#ifndef INCLUDE_CPP_RULE_CACHE_H_
+#define INCLUDE_CPP_RULE_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+class Rule;
+
+//Thread safe store of parsed rules keyed by rule id ("data/US/CA"). Rules are
+//immutable once inserted and handed out as shared pointers, so a rule stays
+//valid for as long as anyone holds it, even once it's been evicted.
+//
+//With a byte budget, whole regions are evicted least recently used first
+//whenever the rules cached exceed it, and are loaded again on their next use.
+//The region last used is never evicted, even if it alone is over budget.
+class RuleCache {
+public:
+    //0 for no budget
+    explicit RuleCache(size_t max_bytes = 0);
+    RuleCache(const RuleCache&) = delete;
+    RuleCache& operator=(const RuleCache&) = delete;
+
+    //Also marks the key's region as the most recently used
+    std::shared_ptr<const Rule> Get(const std::string& key) const;
+
+    //Returns the rule which ends up cached for key, which is the existing one
+    //if another validator already inserted it. bytes is the rule's estimated
+    //size, see EstimateBytes.
+    std::shared_ptr<const Rule> Insert(const std::string& key, std::shared_ptr<const Rule> rule, size_t bytes);
+
+    //Drops every rule of key's region, e.g. once fresher data for it has been
+    //stored, so they're loaded again on their next use. Not counted as an
+    //eviction.
+    void DropRegion(const std::string& key);
+
+    size_t Size() const;
+    size_t Bytes() const;
+    size_t MaxBytes() const;
+
+    //Rules dropped to stay within the budget
+    uint64_t Evictions() const;
+    void ResetCounters();
+
+    //Rough heap footprint of a rule parsed from data_size bytes of data,
+    //including its compiled postal code matcher
+    static size_t EstimateBytes(const Rule& rule, size_t data_size);
+
+    //Process wide cache shared by every validator created with sharedCache.
+    //Freed once the last validator holding it is destroyed.
+    static std::shared_ptr<RuleCache> Shared();
+
+private:
+    struct Entry {
+        std::shared_ptr<const Rule> rule;
+        size_t bytes;
+    };
+
+    struct Region {
+        std::string code;
+        std::vector<std::string> keys;
+        size_t bytes;
+    };
+
+    //All expect _mutex to be held
+    std::list<Region>::iterator Touch(const std::string& key) const;
+    void Drop(std::list<Region>::iterator region);
+    void Trim();
+
+    size_t _max_bytes;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, Entry> _rules;
+
+    //Most recently used first
+    mutable std::list<Region> _lru;
+    mutable std::unordered_map<std::string, std::list<Region>::iterator> _regions;
+
+    size_t _bytes;
+    uint64_t _evictions;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_RULE_CACHE_H_
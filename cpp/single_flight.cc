@@ -0,0 +1,93 @@
+#include "single_flight.h"
+
+i18n::addressinput::SingleFlight::SingleFlight() : _done(this), _requests(0), _coalesced(0) { }
+
+void i18n::addressinput::SingleFlight::Get(const std::string& key, const Callback& data_ready, const Fetch& fetch) {
+    auto& waiting = _waiting[key];
+    waiting.push_back(&data_ready);
+
+    if(waiting.size() > 1) {
+        _coalesced++;
+        return;
+    }
+
+    //fetch may complete synchronously and erase the entry, so waiting can't
+    //be used past this point
+    _requests++;
+    fetch(key, _done);
+}
+
+uint64_t i18n::addressinput::SingleFlight::Requests() const {
+    return _requests;
+}
+
+uint64_t i18n::addressinput::SingleFlight::Coalesced() const {
+    return _coalesced;
+}
+
+void i18n::addressinput::SingleFlight::ResetCounters() {
+    _requests = 0;
+    _coalesced = 0;
+}
+
+void i18n::addressinput::SingleFlight::Complete(bool success, const std::string& key, std::string *data) {
+    //key may belong to the first waiter, which can be gone once it is called
+    std::string flight_key = key;
+
+    auto it = _waiting.find(flight_key);
+    if(it == _waiting.end()) {
+        delete data;
+        return;
+    }
+
+    auto waiting = std::move(it->second);
+    _waiting.erase(it);
+
+    //Every waiter takes ownership of its data, so copies have to be made
+    //before the original is handed to the first one
+    std::vector<std::string*> copies;
+    for(size_t i = 1; i < waiting.size(); i++) {
+        copies.push_back(data == nullptr ? nullptr : new std::string(*data));
+    }
+
+    (*waiting[0])(success, flight_key, data);
+    for(size_t i = 1; i < waiting.size(); i++) {
+        (*waiting[i])(success, flight_key, copies[i - 1]);
+    }
+}
+
+i18n::addressinput::CoalescingSource::CoalescingSource(const Source* source) : _source(source) { }
+
+void i18n::addressinput::CoalescingSource::Get(const std::string& key, const Callback& data_ready) const {
+    _flights.Get(key, data_ready, [this](const std::string& key, const Callback& done) {
+        _source->Get(key, done);
+    });
+}
+
+const i18n::addressinput::SingleFlight& i18n::addressinput::CoalescingSource::Flights() const {
+    return _flights;
+}
+
+i18n::addressinput::SingleFlight& i18n::addressinput::CoalescingSource::Flights() {
+    return _flights;
+}
+
+i18n::addressinput::CoalescingStorage::CoalescingStorage(Storage* storage) : _storage(storage) { }
+
+void i18n::addressinput::CoalescingStorage::Put(const std::string& key, std::string* data) {
+    _storage->Put(key, data);
+}
+
+void i18n::addressinput::CoalescingStorage::Get(const std::string& key, const Callback& data_ready) const {
+    _flights.Get(key, data_ready, [this](const std::string& key, const Callback& done) {
+        _storage->Get(key, done);
+    });
+}
+
+const i18n::addressinput::SingleFlight& i18n::addressinput::CoalescingStorage::Flights() const {
+    return _flights;
+}
+
+i18n::addressinput::SingleFlight& i18n::addressinput::CoalescingStorage::Flights() {
+    return _flights;
+}
@@ -0,0 +1,92 @@
+#ifndef INCLUDE_CPP_SINGLE_FLIGHT_H_
+#define INCLUDE_CPP_SINGLE_FLIGHT_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libaddressinput/source.h>
+#include <libaddressinput/storage.h>
+
+namespace i18n {
+namespace addressinput {
+
+//Coalesces concurrent Gets of the same key into one underlying request. Every
+//caller that asks for a key while it is in flight is answered when that one
+//request completes, each with its own copy of the data.
+class SingleFlight {
+public:
+    using Callback = i18n::addressinput::Callback<const std::string&, std::string*>;
+    using Fetch = std::function<void (const std::string& key, const Callback& done)>;
+
+    SingleFlight();
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    void Get(const std::string& key, const Callback& data_ready, const Fetch& fetch);
+
+    //Underlying requests issued, and Gets that joined one already in flight
+    uint64_t Requests() const;
+    uint64_t Coalesced() const;
+    void ResetCounters();
+
+private:
+    class Done : public Callback {
+    public:
+        explicit Done(SingleFlight *owner) : _owner(owner) { }
+
+        void operator()(bool success, const std::string& key, std::string *data) const override {
+            _owner->Complete(success, key, data);
+        }
+
+    private:
+        SingleFlight *_owner;
+    };
+
+    void Complete(bool success, const std::string& key, std::string *data);
+
+    std::map<std::string, std::vector<const Callback*>> _waiting;
+    Done _done;
+    uint64_t _requests;
+    uint64_t _coalesced;
+};
+
+class CoalescingSource : public Source {
+public:
+    //Takes ownership of source
+    explicit CoalescingSource(const Source* source);
+
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+    const SingleFlight& Flights() const;
+    SingleFlight& Flights();
+
+private:
+    std::unique_ptr<const Source> _source;
+    mutable SingleFlight _flights;
+};
+
+class CoalescingStorage : public Storage {
+public:
+    //Takes ownership of storage
+    explicit CoalescingStorage(Storage* storage);
+
+    void Put(const std::string& key, std::string* data) override;
+    void Get(const std::string& key, const Callback& data_ready) const override;
+
+    const SingleFlight& Flights() const;
+    SingleFlight& Flights();
+
+private:
+    std::unique_ptr<Storage> _storage;
+    mutable SingleFlight _flights;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_SINGLE_FLIGHT_H_
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <memory>
+
+#include "suggestion_index.h"
+
+namespace {
+
+//Pads both ends so that values shorter than three code points have trigrams
+constexpr char32_t kBoundary = 1;
+constexpr size_t kWordBits = 64;
+
+char32_t fold(char32_t c) {
+    if(c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+    if(c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+    return c;
+}
+
+//Bytes that aren't valid UTF-8 are kept as they are, one code point each
+std::u32string fold(const std::string& value) {
+    std::u32string ret;
+    ret.reserve(value.size());
+
+    size_t i = 0;
+    while(i < value.size()) {
+        unsigned char lead = value[i];
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+
+        bool valid = length > 0 && i + length <= value.size();
+        char32_t c = length == 1 ? lead : lead & (0x7F >> length);
+        for(size_t j = 1; valid && j < length; j++) {
+            unsigned char next = value[i + j];
+            valid = (next & 0xC0) == 0x80;
+            c = (c << 6) | (next & 0x3F);
+        }
+
+        if(!valid) {
+            c = lead;
+            length = 1;
+        }
+        ret.push_back(fold(c));
+        i += length;
+    }
+    return ret;
+}
+
+uint64_t trigram(char32_t a, char32_t b, char32_t c) {
+    return (uint64_t(a) << 42) | (uint64_t(b) << 21) | uint64_t(c);
+}
+
+std::vector<uint64_t> trigrams(const std::u32string& value) {
+    std::u32string padded;
+    padded.reserve(value.size() + 2);
+    padded.push_back(kBoundary);
+    padded.append(value);
+    padded.push_back(kBoundary);
+
+    std::vector<uint64_t> ret;
+    ret.reserve(value.size());
+    for(size_t i = 0; i + 2 < padded.size(); i++) {
+        ret.push_back(trigram(padded[i], padded[i + 1], padded[i + 2]));
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+//Myers' bit-vector algorithm in Hyyrö's formulation for the edit distance
+//between two whole strings. Each text code point costs a handful of word
+//operations, whatever the pattern length up to 64.
+class Pattern {
+public:
+    explicit Pattern(const std::u32string& pattern) : _length(pattern.size()) {
+        std::fill(_ascii, _ascii + 128, 0);
+        for(size_t i = 0; i < _length; i++) {
+            uint64_t bit = uint64_t(1) << i;
+            if(pattern[i] < 128) {
+                _ascii[pattern[i]] |= bit;
+                continue;
+            }
+
+            auto it = std::find_if(_other.begin(), _other.end(),
+                    [&](const std::pair<char32_t, uint64_t>& p) { return p.first == pattern[i]; });
+            if(it == _other.end()) {
+                _other.emplace_back(pattern[i], bit);
+            } else {
+                it->second |= bit;
+            }
+        }
+    }
+
+    int Distance(const std::u32string& text) const {
+        if(_length == 0) return text.size();
+
+        uint64_t pv = ~uint64_t(0);
+        uint64_t mv = 0;
+        uint64_t high = uint64_t(1) << (_length - 1);
+        int score = _length;
+
+        for(char32_t c : text) {
+            uint64_t eq = Eq(c);
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            if(ph & high) {
+                score++;
+            } else if(mh & high) {
+                score--;
+            }
+
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        return score;
+    }
+
+private:
+    uint64_t Eq(char32_t c) const {
+        if(c < 128) return _ascii[c];
+        for(const auto& p : _other) {
+            if(p.first == c) return p.second;
+        }
+        return 0;
+    }
+
+    size_t _length;
+    uint64_t _ascii[128];
+    std::vector<std::pair<char32_t, uint64_t>> _other;
+};
+
+//Plain dynamic programming for queries too long for one word
+int distance(const std::u32string& a, const std::u32string& b) {
+    std::vector<int> row(b.size() + 1);
+    for(size_t j = 0; j <= b.size(); j++) row[j] = j;
+
+    for(size_t i = 1; i <= a.size(); i++) {
+        int diagonal = row[0];
+        row[0] = i;
+        for(size_t j = 1; j <= b.size(); j++) {
+            int above = row[j];
+            row[j] = std::min({above + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+}
+
+size_t i18n::addressinput::SuggestionIndex::Add(const std::vector<std::string>& spellings) {
+    size_t candidate = _candidates++;
+    for(const auto& spelling : spellings) {
+        auto folded = fold(spelling);
+        if(folded.empty()) continue;
+
+        uint32_t id = _spellings.size();
+        for(uint64_t t : trigrams(folded)) {
+            _postings[t].push_back(id);
+        }
+        _spellings.push_back(std::move(folded));
+        _owners.push_back(candidate);
+    }
+    return candidate;
+}
+
+std::vector<i18n::addressinput::Suggestion> i18n::addressinput::SuggestionIndex::Suggest(
+        const std::string& query, size_t limit) const {
+    std::vector<Suggestion> ret;
+    auto folded = fold(query);
+    if(folded.empty() || limit == 0 || _spellings.empty()) return ret;
+
+    std::unique_ptr<Pattern> pattern;
+    if(folded.size() <= kWordBits) {
+        pattern.reset(new Pattern(folded));
+    }
+
+    std::vector<int> best(_candidates, -1);
+    std::vector<bool> scored(_spellings.size(), false);
+    size_t found = 0;
+
+    auto score = [&](uint32_t id) {
+        if(scored[id]) return;
+        scored[id] = true;
+
+        int d = pattern ? pattern->Distance(_spellings[id]) : distance(folded, _spellings[id]);
+        int& current = best[_owners[id]];
+        if(current < 0) found++;
+        if(current < 0 || d < current) current = d;
+    };
+
+    for(uint64_t t : trigrams(folded)) {
+        auto postings = _postings.find(t);
+        if(postings == _postings.end()) continue;
+        for(uint32_t id : postings->second) score(id);
+    }
+
+    if(found < limit) {
+        for(uint32_t id = 0; id < _spellings.size(); id++) score(id);
+    }
+
+    ret.reserve(found);
+    for(size_t i = 0; i < best.size(); i++) {
+        if(best[i] >= 0) ret.push_back(Suggestion{i, best[i]});
+    }
+
+    auto nearest = [](const Suggestion& a, const Suggestion& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.candidate < b.candidate;
+    };
+    if(ret.size() > limit) {
+        std::partial_sort(ret.begin(), ret.begin() + limit, ret.end(), nearest);
+        ret.resize(limit);
+    } else {
+        std::sort(ret.begin(), ret.end(), nearest);
+    }
+    return ret;
+}
+
+size_t i18n::addressinput::SuggestionIndex::Size() const {
+    return _candidates;
+}
@@ -0,0 +1,54 @@
+#ifndef INCLUDE_CPP_SUGGESTION_INDEX_H_
+#define INCLUDE_CPP_SUGGESTION_INDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+struct Suggestion {
+    //Position the candidate was added at
+    size_t candidate;
+
+    //Edit distance in code points from the query to its closest spelling
+    int distance;
+};
+
+//Finds the candidates spelled closest to a possibly misspelled value.
+//Spellings are ASCII and Latin-1 case folded and compared by code point. A
+//trigram index narrows down which spellings get scored, and scoring uses
+//Myers' bit-parallel edit distance, 64 code points at a time.
+class SuggestionIndex {
+public:
+    SuggestionIndex() = default;
+
+    SuggestionIndex(const SuggestionIndex&) = delete;
+    SuggestionIndex& operator=(const SuggestionIndex&) = delete;
+    SuggestionIndex(SuggestionIndex&&) = default;
+    SuggestionIndex& operator=(SuggestionIndex&&) = default;
+
+    //A candidate can have several spellings, e.g. its key, name and Latin
+    //name. Empty spellings are ignored. Returns the candidate's position.
+    size_t Add(const std::vector<std::string>& spellings);
+
+    //Up to limit candidates, nearest first and in order of addition on ties.
+    //Candidates sharing no trigram with the query are only scored when there
+    //aren't enough that do.
+    std::vector<Suggestion> Suggest(const std::string& query, size_t limit) const;
+
+    size_t Size() const;
+
+private:
+    std::vector<std::u32string> _spellings;
+    std::vector<uint32_t> _owners;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> _postings;
+    size_t _candidates = 0;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_SUGGESTION_INDEX_H_
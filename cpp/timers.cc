@@ -0,0 +1,30 @@
+#include "timers.h"
+
+#include "address_validator.h"
+
+Napi::Value set_timeout(Napi::Env env, std::function<void ()> callback, double delay_ms, bool keep_alive) {
+    auto set_timeout = env.Global().Get("setTimeout");
+    if(!set_timeout.IsFunction()) {
+        throw unexpected_type_exception(env, "setTimeout", napi_valuetype::napi_function, set_timeout.Type());
+    }
+
+    auto timer = set_timeout.As<Napi::Function>().Call({
+            Napi::Function::New(env, [callback](const Napi::CallbackInfo&) { callback(); }),
+            Napi::Number::New(env, delay_ms)});
+
+    if(!keep_alive && timer.IsObject()) {
+        auto unref = timer.ToObject().Get("unref");
+        if(unref.IsFunction()) {
+            unref.As<Napi::Function>().Call(timer, {});
+        }
+    }
+
+    return timer;
+}
+
+void clear_timeout(Napi::Env env, Napi::Value timer) {
+    auto clear_timeout = env.Global().Get("clearTimeout");
+    if(clear_timeout.IsFunction()) {
+        clear_timeout.As<Napi::Function>().Call({timer});
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef INCLUDE_CPP_TIMERS_H_
+#define INCLUDE_CPP_TIMERS_H_
+
+#include <functional>
+
+#include <napi.h>
+
+//Schedules callback on the JS event loop through the global setTimeout and
+//returns the timer. Timers that shouldn't hold the process open are unref'd.
+Napi::Value set_timeout(Napi::Env env, std::function<void ()> callback, double delay_ms, bool keep_alive = true);
+
+void clear_timeout(Napi::Env env, Napi::Value timer);
+
+#endif  // INCLUDE_CPP_TIMERS_H_
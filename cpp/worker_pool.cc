@@ -0,0 +1,70 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t threads) : _stopping(false) {
+    for(size_t i = 0; i < std::max<size_t>(threads, 1); i++) {
+        _threads.emplace_back(&WorkerPool::Run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+
+    for(auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Submit(std::function<void ()> job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _ready.notify_one();
+}
+
+size_t WorkerPool::Size() const {
+    return _threads.size();
+}
+
+WorkerPool& WorkerPool::Shared() {
+    static WorkerPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+void WorkerPool::Run() {
+    for(;;) {
+        std::function<void ()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+            if(_stopping) return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void JobCounter::Begin(size_t jobs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running += jobs;
+}
+
+void JobCounter::End() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(--_running == 0) {
+        _idle.notify_all();
+    }
+}
+
+void JobCounter::Wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _running == 0; });
+}
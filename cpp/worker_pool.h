@@ -0,0 +1,60 @@
+#ifndef INCLUDE_CPP_WORKER_POOL_H_
+#define INCLUDE_CPP_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed size pool of native threads used to run CPU bound work off of the JS
+//main thread. Jobs must not touch N-API; results are marshalled back through a
+//Napi::ThreadSafeFunction by the caller.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void Submit(std::function<void ()> job);
+    size_t Size() const;
+
+    //Process wide pool with one thread per hardware thread
+    static WorkerPool& Shared();
+
+private:
+    void Run();
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void ()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    bool _stopping;
+};
+
+//Counts the jobs an owner has running on a pool, so that it can wait for them
+//before freeing what they use. Jobs should hold a shared_ptr to it, as the
+//owner may be gone by the time they call End.
+class JobCounter {
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    void Begin(size_t jobs);
+    void End();
+
+    //Blocks until every job begun has ended
+    void Wait();
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _idle;
+    size_t _running = 0;
+};
+
+#endif  // INCLUDE_CPP_WORKER_POOL_H_
@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "write_behind_buffer.h"
+
+i18n::addressinput::WriteBehindBuffer::WriteBehindBuffer(size_t max_entries, Writer writer)
+    : _max_entries(std::max<size_t>(max_entries, 1))
+    , _writer(std::move(writer))
+    , _batch(0) { }
+
+bool i18n::addressinput::WriteBehindBuffer::Put(const std::string& key, std::string&& data) {
+    auto existing = _index.find(key);
+    if(existing != _index.end()) {
+        _entries[existing->second].second = std::move(data);
+        return false;
+    }
+
+    bool started = _entries.empty();
+    _index.emplace(key, _entries.size());
+    _entries.emplace_back(key, std::move(data));
+
+    if(_entries.size() >= _max_entries) {
+        Flush();
+        //Written already, there is nothing left to schedule
+        return false;
+    }
+    return started;
+}
+
+const std::string* i18n::addressinput::WriteBehindBuffer::Find(const std::string& key) const {
+    auto existing = _index.find(key);
+    return existing == _index.end() ? nullptr : &_entries[existing->second].second;
+}
+
+void i18n::addressinput::WriteBehindBuffer::Flush() {
+    if(_entries.empty()) return;
+
+    //Detached first, the writer may put again
+    Entries entries;
+    entries.swap(_entries);
+    _index.clear();
+    _batch++;
+    _writer(std::move(entries));
+}
+
+void i18n::addressinput::WriteBehindBuffer::Flush(uint64_t batch) {
+    if(batch == _batch) Flush();
+}
+
+uint64_t i18n::addressinput::WriteBehindBuffer::Batch() const {
+    return _batch;
+}
+
+size_t i18n::addressinput::WriteBehindBuffer::Size() const {
+    return _entries.size();
+}
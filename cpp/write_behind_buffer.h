@@ -0,0 +1,55 @@
+#ifndef INCLUDE_CPP_WRITE_BEHIND_BUFFER_H_
+#define INCLUDE_CPP_WRITE_BEHIND_BUFFER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace i18n {
+namespace addressinput {
+
+//Collects storage puts so they can be written as one batch. A later put of a
+//key already waiting replaces its data rather than adding a second entry.
+class WriteBehindBuffer {
+public:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+    using Writer = std::function<void (Entries&& entries)>;
+
+    //Writes by itself once max_entries are waiting
+    WriteBehindBuffer(size_t max_entries, Writer writer);
+
+    WriteBehindBuffer(const WriteBehindBuffer&) = delete;
+    WriteBehindBuffer& operator=(const WriteBehindBuffer&) = delete;
+
+    //Returns true if this put started a new batch, which the caller should
+    //arrange to have flushed after its delay
+    bool Put(const std::string& key, std::string&& data);
+
+    //Data of a put that hasn't been written yet, or null
+    const std::string* Find(const std::string& key) const;
+
+    //Writes whatever is waiting, if anything
+    void Flush();
+
+    //Writes only if batch, as returned by Batch when it started, is still the
+    //one waiting. Lets a timer armed for an earlier batch do nothing.
+    void Flush(uint64_t batch);
+
+    uint64_t Batch() const;
+    size_t Size() const;
+
+private:
+    size_t _max_entries;
+    Writer _writer;
+    Entries _entries;
+    std::unordered_map<std::string, size_t> _index;
+    uint64_t _batch;
+};
+
+}
+}
+
+#endif  // INCLUDE_CPP_WRITE_BEHIND_BUFFER_H_
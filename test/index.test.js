@@ -1,5 +1,8 @@
-const { AddressValidator } = require("../dist/index.js");
+const { AddressValidator, hasProblem, decodeProblems, encodeColumns, LATENCY_BUCKETS_MS } = require("../dist/index.js");
 const { expect } = require("expect");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
 
 describe("AddressValidator", () => {
     var cache = {};
@@ -29,6 +32,679 @@ describe("AddressValidator", () => {
         expect(valid[1]).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
     });
 
+    it("should validate many", async () => {
+        let results = await validator.validateMany([{
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "85192",
+        }, {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        }]);
+        expect(results.length).toEqual(2);
+        expect(results[0][1]).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+        expect(results[1][1]).toEqual({});
+    });
+
+    it("should validate on the worker pool", async () => {
+        let threaded = new AddressValidator({
+            request: async (key) => {
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            get: async (key) => cache[key],
+            put: (key, val) => { cache[key] = val; },
+            threaded: true
+        });
+
+        let valid = await threaded.validate({
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "85192",
+        });
+        expect(valid[1]).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+    });
+
+    it("should share rules between validators", async () => {
+        let requested = [];
+        let options = {
+            request: async (key) => {
+                requested.push(key);
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            get: async (key) => undefined,
+            put: (key, val) => { },
+            sharedCache: true
+        };
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        await new AddressValidator(options).validate(address);
+        let fetched = requested.length;
+        let valid = await new AddressValidator(options).validate(address);
+
+        expect(valid[1]).toEqual({});
+        expect(requested.length).toEqual(fetched);
+    });
+
+    it("should preload regions", async () => {
+        let aggregate = {};
+        let preloaded = new AddressValidator({
+            request: async (key) => {
+                return await fetch("https://chromium-i18n.appspot.com/ssl-aggregate-address/" + key).then(v => v.text());
+            },
+            get: async (key) => aggregate[key],
+            put: (key, val) => { aggregate[key] = val; },
+            preload: true
+        });
+
+        expect(preloaded.isLoaded('US')).toEqual(false);
+        expect(await preloaded.preloadAll(['US', 'CA'])).toBeGreaterThan(0);
+        expect(preloaded.isLoaded('US')).toEqual(true);
+
+        let valid = await preloaded.validate({
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "85192",
+        });
+        expect(valid[1]).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+    });
+
+    it("should normalize", async () => {
+        let aggregate = {};
+        let normalizing = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-aggregate-address/" + key).then(v => v.text()),
+            get: async (key) => aggregate[key],
+            put: (key, val) => { aggregate[key] = val; },
+            preload: true
+        });
+
+        let normalized = await normalizing.normalize({ region_code: 'US', administrative_area: 'Oregon', locality: 'Silverton' });
+        expect(normalized.administrative_area).toEqual('OR');
+        expect(normalized.locality).toEqual('Silverton');
+
+        let many = await normalizing.normalizeMany([
+            { region_code: 'US', administrative_area: 'california' },
+            { region_code: 'CA', administrative_area: 'Ontario' },
+            { region_code: '', administrative_area: 'Oregon' },
+        ]);
+        expect(many.map(a => a.administrative_area)).toEqual(['CA', 'ON', 'Oregon']);
+
+        expect(() => validator.normalize({ region_code: 'US' })).toThrow();
+    });
+
+    it("should get region trees", async () => {
+        let aggregate = {};
+        let preloading = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-aggregate-address/" + key).then(v => v.text()),
+            get: async (key) => aggregate[key],
+            put: (key, val) => { aggregate[key] = val; },
+            preload: true
+        });
+
+        let tree = await preloading.getRegionTree('US', 'en');
+        expect(tree.key).toEqual('US');
+        expect(tree.subRegions.find(r => r.key === 'CA').name).toEqual('California');
+        expect(Object.isFrozen(tree)).toBe(true);
+        expect(await preloading.getRegionTree('US', 'en')).toBe(tree);
+
+        expect(await preloading.getSubregions('US')).toBe(tree.subRegions);
+        expect((await preloading.getSubregions('CN/广东省')).length).toBeGreaterThan(0);
+        expect(await preloading.getSubregions('US/XX')).toEqual([]);
+
+        expect(() => validator.getRegionTree('US')).toThrow();
+    });
+
+    it("should suggest sub regions", async () => {
+        let aggregate = {};
+        let preloading = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-aggregate-address/" + key).then(v => v.text()),
+            get: async (key) => aggregate[key],
+            put: (key, val) => { aggregate[key] = val; },
+            preload: true
+        });
+
+        let suggestions = await preloading.suggest({ region_code: 'US', administrative_area: 'Califronia' }, 'ADMIN_AREA', 3);
+        expect(suggestions.length).toEqual(3);
+        expect(suggestions[0]).toEqual({ key: 'CA', name: 'California', distance: 2 });
+
+        let latin = await preloading.suggest({ region_code: 'JP', administrative_area: 'Tokio' }, 'ADMIN_AREA', 1);
+        expect(latin[0].name).toEqual('東京都');
+
+        expect(await preloading.suggest({ region_code: 'US', administrative_area: 'XX', locality: 'x' }, 'LOCALITY')).toEqual([]);
+        expect(() => preloading.suggest({ region_code: 'US' }, 'POSTAL_CODE')).toThrow();
+    });
+
+    it("should infer sub regions from postal codes", async () => {
+        let aggregate = {};
+        let preloading = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-aggregate-address/" + key).then(v => v.text()),
+            get: async (key) => aggregate[key],
+            put: (key, val) => { aggregate[key] = val; },
+            preload: true
+        });
+
+        expect(await preloading.inferRegionFromPostalCode('US', '97381')).toEqual({ administrative_area: 'OR' });
+        expect(await preloading.inferRegionFromPostalCode('US', '94105-1234')).toEqual({ administrative_area: 'CA' });
+        expect(await preloading.inferRegionFromPostalCode('US', 'ABCDE')).toEqual({});
+        expect(() => validator.inferRegionFromPostalCode('US', '97381')).toThrow();
+    });
+
+    it("should load in worker threads", async () => {
+        const { Worker } = require("worker_threads");
+        const script = `
+            const { parentPort } = require("worker_threads");
+            const { AddressValidator } = require(${JSON.stringify(path.join(__dirname, "../dist/index.js"))});
+            const cache = {};
+            const validator = new AddressValidator({
+                request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+                get: async (key) => cache[key],
+                put: (key, val) => { cache[key] = val; },
+                threaded: true
+            });
+            validator.validate({ region_code: 'US', administrative_area: 'OR', locality: 'Silverton', postal_code: '85192', address_line: ['441 n water st'] })
+                .then(result => parentPort.postMessage(result[1]));
+        `;
+
+        let run = () => new Promise((resolve, reject) => {
+            let worker = new Worker(script, { eval: true });
+            worker.once("message", problems => worker.terminate().then(() => resolve(problems)));
+            worker.once("error", reject);
+        });
+
+        let results = await Promise.all([run(), run()]);
+        expect(results).toEqual([{POSTAL_CODE: ['MISMATCHING_VALUE']}, {POSTAL_CODE: ['MISMATCHING_VALUE']}]);
+    });
+
+    it("should persist to a storage file", async () => {
+        let file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "addressinput-")), "storage.db");
+        let requested = 0;
+        let options = {
+            request: async (key) => {
+                requested++;
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            storagePath: file
+        };
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        await new AddressValidator(options).validate(address);
+        let fetched = requested;
+        let valid = await new AddressValidator(options).validate(address);
+
+        expect(valid[1]).toEqual({});
+        expect(requested).toEqual(fetched);
+        expect(fs.statSync(file).size).toBeGreaterThan(0);
+    });
+
+    it("should skip a torn record in a storage file", async () => {
+        let file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "addressinput-")), "storage.db");
+        let requested = 0;
+        let options = {
+            request: async (key) => {
+                requested++;
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            storagePath: file
+        };
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        let first = new AddressValidator(options);
+        await first.validate(address);
+        let fetched = requested;
+
+        //A record cut off mid-write, as a crash would leave it, then one written after it
+        let contents = fs.readFileSync(file);
+        fs.writeFileSync(file, Buffer.concat([contents.subarray(0, contents.length / 2), contents]));
+
+        let valid = await new AddressValidator(options).validate(address);
+
+        expect(valid[1]).toEqual({});
+        expect(requested).toEqual(fetched);
+        expect(first.getStats().storage.writeErrors).toEqual(0);
+    });
+
+    it("should validate offline from a local dataset", async () => {
+        let dataset = path.join(__dirname, "../external/libaddressinput/testdata/countryinfo.txt");
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        let ondemand = await new AddressValidator({ datasetPath: dataset }).validate(address);
+        let preloaded = await new AddressValidator({ datasetPath: dataset, preload: true }).validate(address);
+        let mismatch = await new AddressValidator({ datasetPath: dataset }).validate({...address, postal_code: "12345"});
+
+        expect(ondemand[1]).toEqual({});
+        expect(preloaded[1]).toEqual({});
+        expect(mismatch[1]).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+
+        let stored = {};
+        let exporting = new AddressValidator({ datasetPath: dataset, put: (key, val) => { stored[key] = val; } });
+        expect((await exporting.validate(address))[1]).toEqual({});
+        expect(Object.keys(stored)).toContain("data/US");
+
+        let looked = [];
+        let importing = new AddressValidator({ datasetPath: dataset, get: async (key) => { looked.push(key); return stored[key]; } });
+        expect((await importing.validate(address))[1]).toEqual({});
+        expect(looked).toContain("data/US");
+        expect(() => new AddressValidator({ datasetPath: path.join(__dirname, "missing.txt") })).toThrow();
+    });
+
+    it("should export a profile and prefetch it", async () => {
+        let cache = {};
+        let options = {
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+            get: async (key) => cache[key],
+            put: (key, val) => { cache[key] = val; },
+        };
+        let recording = new AddressValidator(options);
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        await recording.validate(address);
+        await recording.validate(address);
+        await recording.validate({ region_code: 'US', administrative_area: 'CA', postal_code: "94043" });
+
+        let profile = recording.exportProfile();
+        expect(profile[0]).toEqual({ key: 'data/US/OR/Silverton', count: 2 });
+        expect(profile.map(e => e.key)).toContain('data/US/CA');
+        expect(recording.exportProfile(1).length).toEqual(1);
+
+        let requested = [];
+        let warmed = new AddressValidator({...options, request: async (key) => {
+            requested.push(key);
+            return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+        }});
+        expect(await warmed.prefetch(JSON.parse(JSON.stringify(profile)), { concurrency: 1 })).toEqual(profile.length);
+        expect(warmed.exportProfile()).toEqual([]);
+        expect(requested).toEqual([]);
+    });
+
+    it("should evict regions to stay within the rule cache budget", async () => {
+        let cache = {};
+        let validator = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+            get: async (key) => cache[key],
+            put: (key, val) => { cache[key] = val; },
+            ruleCache: { maxBytes: 1 }
+        });
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        await validator.validate(address);
+        let loaded = validator.getStats().rules;
+        expect(loaded.entries).toBeGreaterThan(0);
+        expect(loaded.bytes).toBeGreaterThan(1);
+        expect(loaded.maxBytes).toEqual(1);
+
+        await validator.validate({ region_code: 'CA', administrative_area: 'QC', postal_code: "H3B 2Y5" });
+        let evicted = validator.getStats().rules;
+        expect(evicted.evictions).toEqual(loaded.entries);
+
+        let valid = await validator.validate(address);
+        expect(valid[1]).toEqual({});
+        expect(() => new AddressValidator({ request: async () => "{}", get: async () => undefined, put: () => {}, ruleCache: {}, preload: true })).toThrow();
+    });
+
+    it("should batch puts with putMany", async () => {
+        let stored = {};
+        let batches = [];
+        let batching = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+            get: async (key) => stored[key],
+            putMany: (entries) => {
+                batches.push(entries.length);
+                entries.forEach(([key, val]) => { stored[key] = val; });
+            },
+            writeBehind: { maxEntries: 1000, maxDelayMs: 0 }
+        });
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        expect((await batching.validate(address))[1]).toEqual({});
+        expect(batches).toEqual([]);
+
+        await batching.flush();
+        expect(batches.length).toEqual(1);
+        expect(batches[0]).toEqual(Object.keys(stored).length);
+        expect(batches[0]).toBeGreaterThan(0);
+
+        await batching.flush();
+        expect(batches.length).toEqual(1);
+
+        expect(() => new AddressValidator({ request: async () => "", get: async () => undefined })).toThrow();
+    });
+
+    it("should coalesce concurrent requests", async () => {
+        let requested = {};
+        let coalescing = new AddressValidator({
+            request: async (key) => {
+                requested[key] = (requested[key] || 0) + 1;
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            get: async (key) => undefined,
+            put: (key, val) => { },
+        });
+        let address = {
+            region_code: 'BR',
+            address_line: ['Rua Augusta 1000'],
+            administrative_area: 'SP',
+            locality: 'São Paulo',
+            postal_code: "01304-001",
+        };
+
+        await Promise.all([1, 2, 3, 4].map(() => coalescing.validate(address)));
+
+        expect(requested["data/BR"]).toEqual(1);
+        expect(coalescing.getStats().source.coalesced).toBeGreaterThan(0);
+    });
+
+    it("should retry failed requests", async () => {
+        let attempts = 0;
+        let flaky = new AddressValidator({
+            request: async (key) => {
+                if(key == "data/NZ" && attempts++ < 2) throw new Error("unavailable");
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            get: async (key) => undefined,
+            put: (key, val) => { },
+            resilience: { retries: 2, backoffMs: 1, negativeTtlMs: 60000 },
+        });
+
+        let result = await flaky.validate({
+            region_code: 'NZ',
+            address_line: ['1 Queen Street'],
+            locality: 'Auckland',
+            postal_code: "1010",
+        });
+
+        expect(result[1]).toEqual({});
+        let stats = flaky.getStats().source;
+        expect(stats.retries).toEqual(2);
+        expect(stats.failures).toEqual(0);
+    });
+
+    it("should cache results", async () => {
+        let cached = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+            get: async (key) => undefined,
+            put: (key, val) => { },
+            resultCache: { maxEntries: 2 },
+        });
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        let first = await cached.validate(address);
+        let second = await cached.validate(address);
+        let many = await cached.validateMany([address, { ...address, postal_code: "9738" }]);
+
+        expect(second).toEqual(first);
+        expect(many[0]).toEqual(first);
+        expect(many[1][1]).toHaveProperty("POSTAL_CODE");
+
+        let stats = cached.getStats().results;
+        expect(stats.hits).toEqual(2);
+        expect(stats.entries).toEqual(2);
+    });
+
+    it("should report and reset metrics", async () => {
+        let stored = {};
+        let measured = new AddressValidator({
+            request: async (key) => await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text()),
+            get: async (key) => stored[key],
+            put: (key, val) => { stored[key] = val; },
+            resultCache: true,
+        });
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+
+        await measured.validate(address);
+        await measured.validate(address);
+
+        let stats = measured.getStats();
+        expect(stats.validations.count).toEqual(2);
+        expect(stats.validations.inflight).toEqual(0);
+        expect(stats.validations.latency.count).toEqual(2);
+        expect(stats.validations.latency.buckets.length).toEqual(LATENCY_BUCKETS_MS.length);
+        expect(stats.source.calls).toBeGreaterThan(0);
+        expect(stats.source.latency.count).toEqual(stats.source.calls);
+        expect(stats.storage.puts).toEqual(stats.source.calls);
+        expect(stats.regions.US.ruleMisses).toBeGreaterThan(0);
+        expect(stats.regions.US.resultHits).toEqual(1);
+        expect(stats.regions.US.resultMisses).toEqual(1);
+
+        measured.resetStats();
+        stats = measured.getStats();
+        expect(stats.validations.count).toEqual(0);
+        expect(stats.validations.latency.sumMs).toEqual(0);
+        expect(stats.source.requests).toEqual(0);
+        expect(stats.results.hits).toEqual(0);
+        expect(stats.results.entries).toEqual(1);
+        expect(stats.regions).toEqual({});
+    });
+
+    it("should time out and abort validations", async () => {
+        let hung = [];
+        let stalled = new AddressValidator({
+            request: (key) => new Promise(resolve => hung.push(resolve)),
+            get: async (key) => undefined,
+            put: (key, val) => { },
+        });
+        let address = { region_code: 'US', administrative_area: 'OR', locality: 'Silverton' };
+
+        let started = Date.now();
+        await expect(stalled.validate(address, { timeoutMs: 50 })).rejects.toThrow("timed out");
+        expect(Date.now() - started).toBeLessThan(1000);
+
+        let controller = new AbortController();
+        let aborted = stalled.validateMany([address, address], { signal: controller.signal });
+        controller.abort();
+        await expect(aborted).rejects.toHaveProperty("name", "AbortError");
+
+        await expect(stalled.validate(address, { signal: AbortSignal.abort() })).rejects.toHaveProperty("name", "AbortError");
+
+        //Nobody is waiting anymore, so answering late must be harmless
+        hung.forEach(resolve => resolve("{}"));
+        await new Promise(resolve => setTimeout(resolve, 10));
+        expect(stalled.getStats().validations.inflight).toEqual(0);
+    });
+
+    it("should fail a hung request once every caller has timed out", async () => {
+        let requested = [];
+        let stalled = new AddressValidator({
+            request: (key) => { requested.push(key); return new Promise(() => {}); },
+            get: async (key) => undefined,
+            put: (key, val) => { },
+        });
+        let address = { region_code: 'US', administrative_area: 'OR' };
+
+        //Keeps a call waiting throughout, as steady traffic would
+        let busy = stalled.validate({ region_code: 'GB' }, { timeoutMs: 300 }).catch(e => e);
+        await expect(stalled.validate(address, { timeoutMs: 50 })).rejects.toThrow("timed out");
+        let joined = stalled.validate(address, { timeoutMs: 1000 }).catch(e => e);
+
+        await busy;
+        let started = Date.now();
+        await joined;
+        expect(Date.now() - started).toBeLessThan(500);
+
+        await expect(stalled.validate(address, { timeoutMs: 50 })).rejects.toThrow("timed out");
+        expect(requested.filter(key => key === "data/US").length).toEqual(2);
+    });
+
+    it("should return the address with its problems", async () => {
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st', 'Suite 200'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "9738",
+        };
+
+        let [data, problems] = await validator.validate(address);
+
+        expect(data).toMatchObject(address);
+        expect(data.recipient).toEqual("");
+        expect(problems).toEqual({POSTAL_CODE: ['INVALID_FORMAT']});
+    });
+
+    it("should validate many as problem masks", async () => {
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+        let batch = [address, { ...address, postal_code: "12345" }];
+
+        let masks = await validator.validateManyCompact(batch);
+        let results = await validator.validateMany(batch);
+
+        expect(masks.length).toEqual(4);
+        expect(hasProblem(masks, 0)).toEqual(false);
+        expect(hasProblem(masks, 1, 'POSTAL_CODE', 'MISMATCHING_VALUE')).toEqual(true);
+        expect(decodeProblems(masks, 1)).toEqual(results[1][1]);
+    });
+
+    it("should validate columns", async () => {
+        let address = {
+            region_code: 'US',
+            address_line: ['441 n water st', 'Suite 1'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+        };
+        let batch = [address, { ...address, postal_code: "12345" }, { ...address, locality: 'Zürich' }];
+
+        let columns = encodeColumns(batch);
+        expect(columns.count).toEqual(3);
+        expect(columns.recipient).toBeUndefined();
+
+        let masks = await validator.validateColumns(columns);
+        expect(masks).toEqual(await validator.validateManyCompact(batch));
+
+        columns.postal_code.offsets[1] = 1000;
+        expect(() => validator.validateColumns(columns)).toThrow();
+    });
+
+    it("should validate streamed ndjson and csv", async () => {
+        const { Readable } = require("stream");
+        const collect = async (stream) => {
+            let chunks = [];
+            for await (const chunk of stream) chunks.push(chunk);
+            return chunks;
+        };
+
+        let ndjson = [
+            JSON.stringify({ region_code: 'US', address_line: ['441 n water st'], administrative_area: 'OR', locality: 'Silverton', postal_code: '97381' }),
+            '{not json}',
+            JSON.stringify({ region_code: 'US', address_line: ['441 n water st'], administrative_area: 'OR', locality: 'Silverton', postal_code: '12345' }),
+        ].join("\n");
+        let chunks = await collect(Readable.from([Buffer.from(ndjson.slice(0, 50)), Buffer.from(ndjson.slice(50))])
+            .pipe(validator.createValidationStream({ format: 'ndjson', batchSize: 2 })));
+
+        expect(chunks.map(c => c.first)).toEqual([0, 2]);
+        expect(chunks[0].errors).toEqual([{ record: 1, line: 2, message: expect.any(String) }]);
+        expect(hasProblem(chunks[0].masks, 0)).toEqual(false);
+        expect(decodeProblems(chunks[1].masks, 0)).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+
+        let csv = 'region_code,address_line_1,administrative_area,locality,postal_code\r\n'
+            + 'US,"441 n water st",OR,Silverton,97381\r\n'
+            + 'US,"441 n water st",OR,Silverton,12345\r\n';
+        chunks = await collect(Readable.from([Buffer.from(csv)])
+            .pipe(validator.createValidationStream({ format: 'csv' })));
+
+        expect(chunks.length).toEqual(1);
+        expect(chunks[0].errors).toEqual([]);
+        expect(hasProblem(chunks[0].masks, 0)).toEqual(false);
+        expect(hasProblem(chunks[0].masks, 1, 'POSTAL_CODE', 'MISMATCHING_VALUE')).toEqual(true);
+    });
+
+    it("should report streamed records whose rules can't be loaded and carry on", async () => {
+        const { Readable } = require("stream");
+        let stored = {};
+        let failing = new AddressValidator({
+            request: async (key) => {
+                if(key.startsWith("data/DE")) throw new Error("unavailable");
+                return await fetch("https://chromium-i18n.appspot.com/ssl-address/" + key).then(v => v.text());
+            },
+            get: async (key) => stored[key],
+            put: (key, val) => { stored[key] = val; }
+        });
+
+        let ndjson = [
+            '{not json}',
+            JSON.stringify({ region_code: 'DE', address_line: ['Unter den Linden 1'], locality: 'Berlin', postal_code: '10117' }),
+            JSON.stringify({ region_code: 'US', address_line: ['441 n water st'], administrative_area: 'OR', locality: 'Silverton', postal_code: '12345' }),
+        ].join("\n");
+        let chunks = [];
+        for await (const chunk of Readable.from([Buffer.from(ndjson)]).pipe(failing.createValidationStream({ format: 'ndjson' }))) {
+            chunks.push(chunk);
+        }
+
+        expect(chunks.length).toEqual(1);
+        expect(chunks[0].errors).toEqual([
+            { record: 0, line: 1, message: expect.any(String) },
+            { record: 1, line: 2, message: "Failed to load rules for region DE" },
+        ]);
+        expect(decodeProblems(chunks[0].masks, 2)).toEqual({POSTAL_CODE: ['MISMATCHING_VALUE']});
+    });
+
     it("should format", async() => {
         let data = {
             region_code: 'US',
@@ -43,4 +719,26 @@ describe("AddressValidator", () => {
         
         expect(str).toEqual("Portrait Express\n441 n water st\nSilverton, OR 97381");
     })
+
+    it("should format many", async() => {
+        let data = {
+            region_code: 'US',
+            address_line: ['441 n water st', 'Suite 2'],
+            administrative_area: 'OR',
+            locality: 'Silverton',
+            postal_code: "97381",
+            organization: "Portrait Express",
+        };
+
+        expect(validator.formatMany([data, data])).toEqual([validator.format(data), validator.format(data)]);
+        expect(validator.formatMany([data], { lines: true })).toEqual([
+            ["Portrait Express", "441 n water st", "Suite 2", "Silverton, OR 97381"]
+        ]);
+        expect(validator.formatMany([data], { style: 'single_line' })).toEqual([
+            "Portrait Express, 441 n water st, Suite 2, Silverton, OR 97381"
+        ]);
+        expect(validator.formatMany([data], { style: 'street', lines: true })).toEqual([["441 n water st, Suite 2"]]);
+        expect(validator.formatMany([data], { style: 'latin' })).toEqual([validator.format(data)]);
+        expect(() => validator.formatMany([data], { style: 'label' })).toThrow();
+    })
 });
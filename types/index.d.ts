@@ -1,21 +1,147 @@
 export type GetCallback = (key: string) => Promise<string> | string;
 export type PutCallback = (key: string, data: string) => void;
+export type PutManyCallback = (entries: [string, string][]) => Promise<void> | void;
+/**
+ * How failures of the `request` callback are handled. A request fails when it throws or its
+ * promise rejects.
+ */
+export type ResilienceOpts = {
+    /**
+     * Milliseconds a key keeps failing immediately after its last attempt failed, instead of
+     * calling `request` again for every validation. Defaults to 0 (disabled).
+     */
+    negativeTtlMs?: number;
+    /**
+     * Additional attempts after a failed request. Defaults to 0.
+     */
+    retries?: number;
+    /**
+     * Delay before the first retry, doubled for each one after that and jittered by +/-50%.
+     * Defaults to 100.
+     */
+    backoffMs?: number;
+    /**
+     * Upper bound for the retry delay before jitter. Defaults to 5000.
+     */
+    maxBackoffMs?: number;
+    /**
+     * When storage still holds an expired copy of a key, validate against it right away and
+     * refresh it from `request` in the background. Only validators with `ruleCache` or
+     * `sharedCache` reload the refreshed rules themselves. Defaults to false.
+     */
+    staleWhileRevalidate?: boolean;
+};
+/**
+ * Limits of the validation result cache
+ */
+export type ResultCacheOpts = {
+    /**
+     * Maximum number of cached results. Defaults to 10000.
+     */
+    maxEntries?: number;
+    /**
+     * Approximate maximum memory used by cached results, in bytes. Defaults to 16 MiB.
+     */
+    maxBytes?: number;
+};
+/**
+ * Memory budget for parsed region rules
+ */
+export type RuleCacheOpts = {
+    /**
+     * Approximate maximum memory used by parsed rules and their compiled patterns, in bytes.
+     * 0, the default, is unlimited.
+     */
+    maxBytes?: number;
+};
+/**
+ * When buffered `putMany` writes are handed over
+ */
+export type WriteBehindOpts = {
+    /**
+     * Write once this many keys are waiting. Defaults to 100.
+     */
+    maxEntries?: number;
+    /**
+     * Write at most this long after the first put of a batch. Defaults to 50. 0 only writes
+     * when `maxEntries` is reached or on `flush`.
+     */
+    maxDelayMs?: number;
+};
 /**
  * Options specified when creating a validator
  */
 export type AddressValidatorOpts = {
     /**
-     * Callback that requests the data from whatever source is expected
+     * Callback that requests the data from whatever source is expected. Required unless
+     * `datasetPath` is set.
+     */
+    request?: GetCallback;
+    /**
+     * Callback that gets any data that was previously stored with `put`. Required unless
+     * `storagePath` or `datasetPath` is set.
+     */
+    get?: GetCallback;
+    /**
+     * Callback that stores a key's data to cache it for later. Required unless `storagePath`,
+     * `putMany` or `datasetPath` is set.
+     */
+    put?: PutCallback;
+    /**
+     * Callback that stores several keys' data at once, e.g. as one pipelined batch. Puts are
+     * buffered as set by `writeBehind` and then handed over as [key, data] entries. Buffered
+     * data is served to lookups before it is written. Takes the place of `put`.
+     */
+    putMany?: PutManyCallback;
+    writeBehind?: WriteBehindOpts;
+    /**
+     * Persist fetched region data natively to this file instead of calling `get`/`put`.
+     * Lookups are served from a memory map of the file, so a restarted process is warm as
+     * soon as it opens it.
+     */
+    storagePath?: string;
+    /**
+     * Serve region data natively from local files instead of calling `request`, for use
+     * without network access. Either a file of `<key>=<data>` lines, the format of
+     * libaddressinput's `testdata/countryinfo.txt`, or a directory of such files. The files
+     * are memory mapped, and indexed on the first lookup.
+     */
+    datasetPath?: string;
+    /**
+     * Run the CPU bound part of validation on a native thread pool instead of the JS main
+     * thread. Rule data is still loaded through `request`/`get`/`put` on the main thread.
      */
-    request: GetCallback;
+    threaded?: boolean;
     /**
-     * Callback that gets any data that was previously stored with `put`
+     * Share parsed region rules with every other validator created with `sharedCache`. Rules
+     * already loaded by any of them are reused, and only missing keys go through this
+     * validator's own `request`/`get`/`put` callbacks.
      */
-    get: GetCallback;
+    sharedCache?: boolean;
     /**
-     * Callback that stores a key's data to cache it for later
+     * Back the validator with libaddressinput's PreloadSupplier, which loads every rule of a
+     * region in one request. `request` must then serve aggregated region data, e.g. from
+     * `https://chromium-i18n.appspot.com/ssl-aggregate-address/`. Regions that haven't been
+     * preloaded are loaded on first use. Can not be combined with `sharedCache`.
      */
-    put: PutCallback;
+    preload?: boolean;
+    /**
+     * Negative caching, retries and stale-while-revalidate for the `request` callback
+     */
+    resilience?: ResilienceOpts;
+    /**
+     * Remember validation results, so validating the same address with the same options again
+     * resolves without running the validator. The least recently used results are dropped once
+     * a limit is reached, and a region's results are dropped when its rule data is fetched again.
+     * `true` uses the default limits.
+     */
+    resultCache?: boolean | ResultCacheOpts;
+    /**
+     * Keep parsed rules within a memory budget. Once over it, the rules of the least recently
+     * used regions are dropped, and loaded again through `get`/`request` when next needed.
+     * Can not be combined with `preload` or `sharedCache`.
+     */
+    ruleCache?: RuleCacheOpts;
 };
 /**
  * Represents an issue with an address field.
@@ -89,10 +215,404 @@ export type FieldProblemMap = {
     ORGANIZATION?: AddressProblem[];
     RECIPIENT?: AddressProblem[];
 };
+/**
+ * The parts of an `AbortSignal` the validator uses
+ */
+export interface AbortSignalLike {
+    readonly aborted: boolean;
+    readonly reason?: any;
+    addEventListener(type: "abort", listener: () => void): void;
+    removeEventListener(type: "abort", listener: () => void): void;
+}
 export type ValidateAddressOpts = {
     allow_postal?: boolean;
     require_name?: boolean;
     filter?: FieldProblemMap;
+    /**
+     * Reject with a `TimeoutError` if the call hasn't settled after this many milliseconds
+     */
+    timeoutMs?: number;
+    /**
+     * Reject with the signal's reason, or an `AbortError`, once it is aborted
+     */
+    signal?: AbortSignalLike;
+};
+/**
+ * `national` is the region's local format, `latin` its Latin script format where it has one
+ * (e.g. JP), `single_line` the national format on one line, and `street` only the street
+ * address lines on one line.
+ */
+export type FormatStyle = "national" | "latin" | "single_line" | "street";
+export type FormatOpts = {
+    style?: FormatStyle;
+    /**
+     * Return each address as an array of lines instead of a string
+     */
+    lines?: boolean;
+};
+/**
+ * A field name as used in `FieldProblemMap`
+ */
+export type AddressField = keyof FieldProblemMap;
+/**
+ * Number of `Uint32Array` entries per address in the result of `validateManyCompact`
+ */
+export declare const PROBLEM_MASK_WORDS = 2;
+/**
+ * Bit of a field/problem pair within an address's problem mask. Bits 0-31 are in the first
+ * word of the address, bits 32 and up in the second.
+ *
+ * @param {AddressField} field
+ * @param {AddressProblem} problem
+ * @returns {number}
+ */
+export declare function problemBit(field: AddressField, problem: AddressProblem): number;
+/**
+ * Check an address's entry in the result of `validateManyCompact`
+ *
+ * @param {Uint32Array} masks Result of `validateManyCompact`
+ * @param {number} index Index of the address in the validated batch
+ * @param {AddressField} [field] Only check this field
+ * @param {AddressProblem} [problem] Only check this problem, requires `field`
+ * @returns {boolean} Whether the address has any matching problem
+ */
+export declare function hasProblem(masks: Uint32Array, index: number, field?: AddressField, problem?: AddressProblem): boolean;
+/**
+ * Expand an address's entry in the result of `validateManyCompact` into a problem map
+ *
+ * @param {Uint32Array} masks Result of `validateManyCompact`
+ * @param {number} index Index of the address in the validated batch
+ * @returns {FieldProblemMap} The same map `validateMany` would have returned
+ */
+export declare function decodeProblems(masks: Uint32Array, index: number): FieldProblemMap;
+/**
+ * One field of a batch of addresses: every value's UTF-8 bytes back to back in `data`, the
+ * value of address `i` being `data[offsets[i]]` up to `data[offsets[i + 1]]`. Street lines
+ * are separated by newlines. Either array may be a view of a `SharedArrayBuffer`.
+ */
+export type AddressColumn = {
+    data: Uint8Array;
+    /**
+     * `count + 1` entries
+     */
+    offsets: Uint32Array;
+};
+/**
+ * A batch of addresses stored by field. Missing fields are empty for every address.
+ */
+export type AddressColumns = {
+    count: number;
+} & {
+    [K in keyof AddressData]?: AddressColumn;
+};
+/**
+ * Store a batch of addresses as columns for `validateColumns`. Mainly useful for tests, as the
+ * point of columns is to build them without creating an object per address.
+ *
+ * @param {Partial<AddressData>[]} data The address objects
+ * @returns {AddressColumns}
+ */
+export declare function encodeColumns(data: Partial<AddressData>[]): AddressColumns;
+/**
+ * Options for `createValidationStream`
+ */
+export type ValidationStreamOpts = ValidateAddressOpts & {
+    /**
+     * `ndjson`: one JSON object per line, keyed like `AddressData`. `address_line` may be an
+     * array or a newline separated string.
+     *
+     * `csv`: a header row naming `AddressData` properties, then one address per row. Street
+     * lines come from an `address_line` column split on newlines, or from `address_line_1`,
+     * `address_line_2`... columns. Unknown keys and columns are ignored.
+     */
+    format: 'ndjson' | 'csv';
+    /**
+     * Records validated per emitted chunk. Defaults to 256.
+     */
+    batchSize?: number;
+    /**
+     * Batches being validated at once. Writes wait while this many are pending. Defaults to 4.
+     */
+    concurrency?: number;
+    /**
+     * Longest accepted record in bytes. Longer ones are reported as errors and skipped.
+     * Defaults to 1 MiB.
+     */
+    maxRecordBytes?: number;
+};
+/**
+ * A record in a validation stream that couldn't be parsed, or whose region's rules couldn't
+ * be loaded
+ */
+export type RecordError = {
+    /**
+     * Index of the record in the stream, counted from 0
+     */
+    record: number;
+    /**
+     * Line the record starts on, counted from 1
+     */
+    line: number;
+    message: string;
+};
+/**
+ * Results of one batch of a validation stream
+ */
+export type ValidationChunk = {
+    /**
+     * Index of the batch's first record in the stream
+     */
+    first: number;
+    /**
+     * Problem masks of the batch's records, `PROBLEM_MASK_WORDS` entries each. Read them with
+     * `hasProblem` and `decodeProblems`, using the record's index within the batch.
+     */
+    masks: Uint32Array;
+    /**
+     * Records of the batch that couldn't be parsed or validated, in record order. Their masks
+     * are empty.
+     */
+    errors: RecordError[];
+};
+/**
+ * The Node.js `stream.Transform` returned by `createValidationStream`. Takes NDJSON or CSV
+ * bytes and emits a `ValidationChunk` per batch, in input order.
+ */
+export interface ValidationStream {
+    write(chunk: Uint8Array | string, callback?: (err?: Error) => void): boolean;
+    end(callback?: () => void): this;
+    pipe<T>(destination: T, options?: {
+        end?: boolean;
+    }): T;
+    on(event: string, listener: (...args: any[]) => void): this;
+}
+/**
+ * Upper bounds, in milliseconds, of the buckets of every {@link LatencyStats}
+ */
+export declare const LATENCY_BUCKETS_MS: readonly number[];
+/**
+ * Fixed bucket latency histogram, shaped to export as a Prometheus histogram
+ */
+export type LatencyStats = {
+    count: number;
+    sumMs: number;
+    /**
+     * Cumulative observation counts, `buckets[i]` being those that took at most
+     * `LATENCY_BUCKETS_MS[i]`. `count` is the `+Inf` bucket.
+     */
+    buckets: number[];
+};
+/**
+ * Counters for the `request` callback or the storage layer
+ */
+export type FetchStats = {
+    /**
+     * Requests actually made to the underlying callback or store
+     */
+    requests: number;
+    /**
+     * Lookups that joined a request for the same key which was already in flight
+     */
+    coalesced: number;
+    /**
+     * Calls made to the callback or store itself, including retries and refreshes
+     */
+    calls: number;
+    /**
+     * Time from each call until its data, or failure, came back
+     */
+    latency: LatencyStats;
+};
+/**
+ * Counters for the `request` callback. The resilience counters stay 0 unless the validator was
+ * created with `resilience`.
+ */
+export type SourceStats = FetchStats & {
+    /**
+     * Retries scheduled after a failed request
+     */
+    retries: number;
+    /**
+     * Keys that failed after every retry
+     */
+    failures: number;
+    /**
+     * Lookups failed immediately because the key recently failed
+     */
+    negativeHits: number;
+    /**
+     * Lookups answered with expired data from storage
+     */
+    staleServed: number;
+    /**
+     * Background refreshes started for expired keys
+     */
+    refreshes: number;
+};
+/**
+ * Counters for the validation result cache. All 0 unless the validator was created with
+ * `resultCache`.
+ */
+export type ResultCacheStats = {
+    hits: number;
+    misses: number;
+    /**
+     * Results dropped to stay within the configured limits
+     */
+    evictions: number;
+    entries: number;
+    /**
+     * Approximate memory used by cached results
+     */
+    bytes: number;
+};
+/**
+ * Usage of the parsed rule cache. All 0 unless the validator was created with `ruleCache`
+ * or `sharedCache`, and shared by every `sharedCache` validator.
+ */
+export type RuleCacheStats = {
+    /**
+     * Parsed rules currently cached
+     */
+    entries: number;
+    /**
+     * Approximate memory they use
+     */
+    bytes: number;
+    /**
+     * The configured budget, 0 if unlimited
+     */
+    maxBytes: number;
+    /**
+     * Rules dropped to stay within the budget
+     */
+    evictions: number;
+};
+/**
+ * Counters for the storage layer
+ */
+export type StorageStats = FetchStats & {
+    puts: number;
+    /**
+     * Records that `storagePath`'s file couldn't be written, always 0 for other storage
+     */
+    writeErrors: number;
+};
+/**
+ * Validation calls, each `validate`, `validateMany` and `validateManyCompact` counting once
+ */
+export type ValidationStats = {
+    count: number;
+    /**
+     * Calls that have not settled yet
+     */
+    inflight: number;
+    /**
+     * From the call until its promise settles
+     */
+    latency: LatencyStats;
+    /**
+     * Converting results into JS values
+     */
+    marshalling: LatencyStats;
+};
+/**
+ * Cache counters of one region
+ */
+export type RegionStats = {
+    /**
+     * Rule lookups answered by an unexpired copy in storage, and requests made for the region,
+     * retries and refreshes included
+     */
+    ruleHits: number;
+    ruleMisses: number;
+    /**
+     * Result cache lookups for addresses in the region
+     */
+    resultHits: number;
+    resultMisses: number;
+};
+/**
+ * Runtime counters of a validator
+ */
+export type ValidatorStats = {
+    validations: ValidationStats;
+    source: SourceStats;
+    storage: StorageStats;
+    results: ResultCacheStats;
+    rules: RuleCacheStats;
+    /**
+     * Keyed by region code
+     */
+    regions: {
+        [regionCode: string]: RegionStats;
+    };
+};
+/**
+ * A sub region, e.g. a state or prefecture. Trees are cached by the validator and shared
+ * between calls, so they are frozen.
+ */
+export type RegionNode = {
+    /**
+     * The key the data uses, e.g. "CA", which is what validation expects in the address
+     */
+    readonly key: string;
+    /**
+     * Display name in the tree's language, e.g. "California"
+     */
+    readonly name: string;
+    readonly subRegions: ReadonlyArray<RegionNode>;
+};
+export type RegionTree = RegionNode & {
+    /**
+     * The language the names are in, the closest available to the one requested
+     */
+    readonly language: string;
+};
+/**
+ * A sub region that may be what a misspelled field meant
+ */
+export type Suggestion = {
+    key: string;
+    name: string;
+    /**
+     * Edit distance between the field and the closest of the key, name and Latin name
+     */
+    distance: number;
+};
+/**
+ * The fields that hold a sub region, and so can be suggested for
+ */
+export type SubregionField = "ADMIN_AREA" | "LOCALITY" | "DEPENDENT_LOCALITY";
+/**
+ * The sub region fields a postal code implies, as far down as the data allows
+ */
+export type InferredRegion = Partial<Pick<AddressData, "administrative_area" | "locality" | "dependent_locality">>;
+/**
+ * How often a rule key was looked up by validations, as recorded by `exportProfile`
+ */
+export type ProfileEntry = {
+    /**
+     * Rule key, e.g. "data/US/CA"
+     */
+    key: string;
+    /**
+     * Number of lookups
+     */
+    count: number;
+};
+/**
+ * Options for `prefetch`
+ */
+export type PrefetchOpts = {
+    /**
+     * Most keys being loaded at once. Defaults to 4.
+     */
+    concurrency?: number;
+    /**
+     * Only load this many of the hottest keys
+     */
+    limit?: number;
 };
 /**
  * Class to represent a validator instance.
@@ -108,5 +628,177 @@ export declare class AddressValidator {
      * @returns {Promise<[AddressData, FieldProblemMap]>} Tuple of [validated address, problem map]
      */
     validate(data: Partial<AddressData>, opts?: ValidateAddressOpts): Promise<[AddressData, FieldProblemMap]>;
+    /**
+     * Validate a batch of addresses in a single native call. All validations share the
+     * validator's rule cache and settle together.
+     *
+     * @param {Partial<AddressData>[]} data The address objects
+     * @param {ValidateAddressOpts} [opts] Options applied to every address in the batch
+     * @returns {Promise<[AddressData, FieldProblemMap][]>} One [address, problem map] tuple per input, in order
+     */
+    validateMany(data: Partial<AddressData>[], opts?: ValidateAddressOpts): Promise<[AddressData, FieldProblemMap][]>;
+    /**
+     * Validate a batch of addresses, reporting only which fields have which problems. Nothing
+     * is allocated per address: each one gets `PROBLEM_MASK_WORDS` entries of the returned
+     * array, holding a bit per field/problem pair (see `problemBit`). Use `hasProblem` and
+     * `decodeProblems` to read them.
+     *
+     * @param {Partial<AddressData>[]} data The address objects
+     * @param {ValidateAddressOpts} [opts] Options applied to every address in the batch
+     * @returns {Promise<Uint32Array>} `PROBLEM_MASK_WORDS` entries per input, in order
+     */
+    validateManyCompact(data: Partial<AddressData>[], opts?: ValidateAddressOpts): Promise<Uint32Array>;
+    /**
+     * Validate a batch of addresses given as columns, e.g. straight from a columnar file or
+     * another thread. Fields are read natively out of the buffers, without a JS object or
+     * string per address, and the buffers may be reused once this returns. Results are
+     * problem masks as with `validateManyCompact`.
+     *
+     * @param {AddressColumns} columns The addresses, one column per field
+     * @param {ValidateAddressOpts} [opts] Options applied to every address in the batch
+     * @returns {Promise<Uint32Array>} `PROBLEM_MASK_WORDS` entries per address, in order
+     */
+    validateColumns(columns: AddressColumns, opts?: ValidateAddressOpts): Promise<Uint32Array>;
+    /**
+     * Validate a stream of NDJSON or CSV bytes. Records are parsed natively and never become
+     * JS objects. At most `concurrency` batches of `batchSize` records are validated at once,
+     * and writes wait until a batch completes, so memory use doesn't grow with the input.
+     *
+     * @param {ValidationStreamOpts} opts
+     * @returns {ValidationStream} A Transform stream emitting a `ValidationChunk` per batch
+     */
+    createValidationStream(opts: ValidationStreamOpts): ValidationStream;
     format(data: Partial<AddressData>): any;
+    /**
+     * Format a batch of addresses in a single native call. Buffers are reused across the
+     * batch, so large batches of labels don't pay for an allocation per line.
+     *
+     * @param {Partial<AddressData>[]} data The address objects
+     * @param {FormatOpts} [opts] Style, and whether to return lines instead of strings
+     * @returns {string[] | string[][]} One string, lines joined by "\n", or one array of lines per input, in order
+     */
+    formatMany(data: Partial<AddressData>[], opts: FormatOpts & {
+        lines: true;
+    }): string[][];
+    formatMany(data: Partial<AddressData>[], opts?: FormatOpts): string[];
+    /**
+     * Normalize an address against its region's rules, replacing names like "Oregon" or a
+     * Latin spelling of a Japanese prefecture with the key the data uses, e.g. "OR".
+     * Requires a validator created with `preload`. The region is loaded first if needed, and
+     * an address whose region can't be loaded is returned unchanged.
+     *
+     * @param {Partial<AddressData>} data The address object
+     * @returns {Promise<AddressData>} The normalized copy of the address
+     */
+    normalize(data: Partial<AddressData>): Promise<AddressData>;
+    /**
+     * Normalize a batch of addresses in a single native call, loading each region they need
+     * once. Requires a validator created with `preload`.
+     *
+     * @param {Partial<AddressData>[]} data The address objects
+     * @returns {Promise<AddressData[]>} The normalized addresses, in order
+     */
+    normalizeMany(data: Partial<AddressData>[]): Promise<AddressData[]>;
+    /**
+     * Get the hierarchy of sub regions of a region, e.g. the states of the US, to fill
+     * selection lists. Requires a validator created with `preload`. The region is loaded
+     * first if needed.
+     *
+     * @param {string} regionCode ISO 3166-1 region code, e.g. "US"
+     * @param {string} language BCP 47 language tag for the names, defaults to the region's own
+     * @returns {Promise<RegionTree>} The region and all of its sub regions
+     */
+    getRegionTree(regionCode: string, language?: string): Promise<RegionTree>;
+    /**
+     * Get the direct sub regions of a region or sub region, from the same cached tree as
+     * `getRegionTree`.
+     *
+     * @param {string} key Region code followed by sub region keys, e.g. "US" or "CN/广东省"
+     * @param {string} language BCP 47 language tag for the names, defaults to the region's own
+     * @returns {Promise<ReadonlyArray<RegionNode>>} The sub regions, empty if there are none
+     *     or the key is unknown
+     */
+    getSubregions(key: string, language?: string): Promise<ReadonlyArray<RegionNode>>;
+    /**
+     * Suggest the sub regions a field most likely meant, e.g. "California" for an
+     * administrative area of "Califronia" reported as `UNKNOWN_VALUE`. The fields above
+     * `field` pick the list of sub regions and must match one by key or name. Requires a
+     * validator created with `preload`.
+     *
+     * @param {Partial<AddressData>} data The address object
+     * @param {SubregionField} field The field to suggest values for
+     * @param {number} limit The most suggestions to return
+     * @returns {Promise<Suggestion[]>} The suggestions, nearest first
+     */
+    suggest(data: Partial<AddressData>, field: SubregionField, limit?: number): Promise<Suggestion[]>;
+    /**
+     * Infer the sub regions of an address from its postal code, using the zip prefixes in
+     * the region's data, e.g. `{ administrative_area: "OR" }` for US 97381. A level is only
+     * filled in when exactly one sub region matches. Requires a validator created with
+     * `preload`.
+     *
+     * @param {string} regionCode ISO 3166-1 region code, e.g. "US"
+     * @param {string} postalCode The postal code
+     * @returns {Promise<InferredRegion>} The inferred fields, empty if the postal code is
+     *     invalid for the region or no sub region matches
+     */
+    inferRegionFromPostalCode(regionCode: string, postalCode: string): Promise<InferredRegion>;
+    /**
+     * Load every rule for a region ahead of time. Requires a validator created with `preload`.
+     *
+     * @param {string} regionCode ISO 3166-1 region code, e.g. "US"
+     * @returns {Promise<number>} The number of rules loaded, 0 if the region was already loaded
+     */
+    preload(regionCode: string): Promise<number>;
+    /**
+     * Load every rule for several regions ahead of time. Requires a validator created with
+     * `preload`.
+     *
+     * @param {string[]} regionCodes ISO 3166-1 region codes
+     * @returns {Promise<number>} The total number of rules loaded
+     */
+    preloadAll(regionCodes: string[]): Promise<number>;
+    /**
+     * Whether a region's rules are loaded. Requires a validator created with `preload`.
+     *
+     * @param {string} regionCode ISO 3166-1 region code, e.g. "US"
+     * @returns {boolean}
+     */
+    isLoaded(regionCode: string): boolean;
+    /**
+     * The rule keys validations have looked up so far and how often, to warm up another
+     * validator with `prefetch`, e.g. after the next deploy
+     *
+     * @param {number} [limit] Only export this many of the most looked up keys
+     * @returns {ProfileEntry[]} Most looked up first
+     */
+    exportProfile(limit?: number): ProfileEntry[];
+    /**
+     * Load the rules of a profile's keys in the background, most looked up first, so the
+     * first validations after a start don't wait on them. Failed keys are skipped.
+     *
+     * @param {ProfileEntry[]} profile Entries as returned by `exportProfile`
+     * @param {PrefetchOpts} [opts] Concurrency and how many keys to load
+     * @returns {Promise<number>} The number of keys whose rules were loaded
+     */
+    prefetch(profile: ProfileEntry[], opts?: PrefetchOpts): Promise<number>;
+    /**
+     * Runtime counters for this validator
+     *
+     * @returns {ValidatorStats}
+     */
+    getStats(): ValidatorStats;
+    /**
+     * Zeroes the counters and histograms returned by {@link getStats}, for scrapers that
+     * export deltas. Current sizes, like `results.entries` and `validations.inflight`, are
+     * kept.
+     */
+    resetStats(): void;
+    /**
+     * Hand puts buffered for `putMany` over now, e.g. before shutting down. They are also
+     * written when the validator is garbage collected.
+     *
+     * @returns {Promise<void>} Settles with the promise `putMany` returned, if any
+     */
+    flush(): Promise<void>;
 }